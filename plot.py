@@ -4,7 +4,6 @@ import gzip
 import itertools
 import math
 import sys
-import json
 import numpy as np
 import matplotlib.pyplot as plt
 
@@ -14,9 +13,42 @@ fig, axs = plt.subplots(num_plots_down, 2, constrained_layout=True,
 
 axs[0, 0].set_xlabel("Elapsed time(s)")
 
-data = None
-with gzip.open("output.json.gz") as fs:
-    data = json.load(fs)
+def load_telemetry(path):
+    """Reads a telemetry stream, see src/telemetry.h, into nested dicts of arrays"""
+    with gzip.open(path) as fs:
+        raw = fs.read()
+
+    assert raw[:4] == b"RATL"
+    version, num_channels = np.frombuffer(raw, "<u4", 2, 4)
+    assert version == 1
+    offset = 12
+    names = []
+    for _ in range(num_channels):
+        length = int(np.frombuffer(raw, "<u4", 1, offset)[0])
+        names.append(raw[offset + 4:offset + 4 + length].decode())
+        offset += 4 + length
+
+    columns = [[] for _ in names]
+    while offset < len(raw):
+        rows = int(np.frombuffer(raw, "<u4", 1, offset)[0])
+        offset += 4
+        for column in columns:
+            column.append(np.frombuffer(raw, "<f4", rows, offset))
+            offset += rows * 4
+
+    data = {}
+    for name, column in zip(names, columns):
+        *parents, leaf = name.split(".")
+        node = data
+        for parent in parents:
+            node = node.setdefault(parent, {})
+        node[leaf] = np.concatenate(column) if column else np.empty(0, "<f4")
+
+    time = data["elapsed_time"]
+    data["dt"] = float(time[1] - time[0]) if len(time) > 1 else 0.0
+    return data
+
+data = load_telemetry("output.ratl.gz")
 
 time = data["elapsed_time"]
 
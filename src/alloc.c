@@ -0,0 +1,141 @@
+#include "alloc.h"
+#include "common.h"
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+static void* heap_alloc(raAllocator* a, size_t size)
+{
+    SUPPRESS_UNUSED(a);
+    return malloc(size);
+}
+
+static void heap_free(raAllocator* a, void* ptr)
+{
+    SUPPRESS_UNUSED(a);
+    free(ptr);
+}
+
+static void* heap_alloc_aligned(raAllocator* a, size_t size, size_t align)
+{
+    SUPPRESS_UNUSED(a);
+    if (align <= alignof(max_align_t)) {
+        return malloc(size);
+    }
+
+    // aligned_alloc wants a multiple of the alignment
+    return aligned_alloc(align, (size + align - 1) / align * align);
+}
+
+raAllocator ra_heap_allocator = {
+    .alloc = heap_alloc,
+    .free = heap_free,
+    .alloc_aligned = heap_alloc_aligned,
+};
+
+void* ra_alloc(raAllocator* a, size_t size)
+{
+    // Zero sized allocations may return NULL
+    void* p = a->alloc(a, size > 0 ? size : 1);
+    if (p == NULL) {
+        exit(EXIT_FAILURE);
+    }
+
+    return p;
+}
+
+void* ra_alloc_aligned(raAllocator* a, size_t size, size_t align)
+{
+    if (a->alloc_aligned == NULL) {
+        return ra_alloc(a, size);
+    }
+
+    void* p = a->alloc_aligned(a, size > 0 ? size : 1, align);
+    if (p == NULL) {
+        exit(EXIT_FAILURE);
+    }
+
+    return p;
+}
+
+void ra_free(raAllocator* a, void* ptr)
+{
+    if (ptr != NULL) {
+        a->free(a, ptr);
+    }
+}
+
+/** Offset of the first free address aligned to `align`. The address is aligned rather than the
+ * offset, since the block is only aligned to a cache line. */
+static size_t arena_aligned_offset(const raArena* arena, size_t align)
+{
+    uintptr_t base = (uintptr_t)arena->data;
+    return (size_t)(((base + arena->used + align - 1) & ~(uintptr_t)(align - 1)) - base);
+}
+
+static void* arena_alloc_aligned(raAllocator* a, size_t size, size_t align)
+{
+    // The allocator is the first member
+    raArena* arena = (raArena*)a;
+    if (align < alignof(max_align_t)) {
+        align = alignof(max_align_t);
+    }
+    size_t start = arena_aligned_offset(arena, align);
+    if (start > arena->capacity || size > arena->capacity - start) {
+        return NULL;
+    }
+
+    arena->used = start + size;
+    arena->num_allocations++;
+    return arena->data + start;
+}
+
+static void* arena_alloc(raAllocator* a, size_t size)
+{
+    return arena_alloc_aligned(a, size, alignof(max_align_t));
+}
+
+static void arena_free(raAllocator* a, void* ptr)
+{
+    SUPPRESS_UNUSED(a);
+    SUPPRESS_UNUSED(ptr);
+}
+
+void ra_arena_init(raArena* arena, size_t capacity)
+{
+    // Cache line alignment, the most asked for, then needs no padding at the start
+    unsigned char* data = heap_alloc_aligned(NULL, capacity > 0 ? capacity : 1, RA_CACHE_LINE);
+    if (data == NULL) {
+        exit(EXIT_FAILURE);
+    }
+
+    *arena = (raArena) {
+        .allocator = {
+            .alloc = arena_alloc,
+            .free = arena_free,
+            .alloc_aligned = arena_alloc_aligned,
+        },
+        .data = data,
+        .capacity = capacity,
+        .used = 0,
+        .num_allocations = 0,
+    };
+}
+
+void ra_arena_reset(raArena* arena)
+{
+    arena->used = 0;
+    arena->num_allocations = 0;
+}
+
+void ra_arena_align(raArena* arena, size_t align)
+{
+    size_t start = arena_aligned_offset(arena, align);
+    arena->used = start < arena->capacity ? start : arena->capacity;
+}
+
+void ra_arena_free(raArena* arena)
+{
+    free(arena->data);
+    *arena = (raArena) { .data = NULL };
+}
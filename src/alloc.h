@@ -0,0 +1,53 @@
+#ifndef RA_ALLOC_H
+#define RA_ALLOC_H
+#include <stddef.h>
+
+/** Size of the cache lines `ra_alloc_aligned` is usually asked to align to */
+#define RA_CACHE_LINE 64
+
+/** Where constructors ending in `_in` get their memory from. Objects made with
+ * `ra_heap_allocator` are the same as the ones made by the plain constructors. Objects that free
+ * memory themselves, like engines, gearboxes, vectors, tables and tagged components, remember the
+ * allocator they were made with. Wheels, differentials and clutches are freed with `ra_free`. */
+typedef struct raAllocator raAllocator;
+struct raAllocator {
+    /** Returns NULL when out of memory. Memory is aligned like malloc's. */
+    void* (*alloc)(raAllocator* a, size_t size);
+    void (*free)(raAllocator* a, void* ptr);
+    /** Like `alloc`, aligned to `align`, a power of two. Freed with `free`. NULL if the allocator
+     * can only align like malloc. */
+    void* (*alloc_aligned)(raAllocator* a, size_t size, size_t align);
+};
+
+/** malloc and free */
+extern raAllocator ra_heap_allocator;
+
+/** Exits with EXIT_FAILURE when out of memory, like the plain constructors */
+void* ra_alloc(raAllocator* a, size_t size);
+void ra_free(raAllocator* a, void* ptr);
+/** Same as `ra_alloc` aligned to `align`, or like malloc if the allocator has no `alloc_aligned`.
+ * Freed with `ra_free`. */
+void* ra_alloc_aligned(raAllocator* a, size_t size, size_t align);
+
+/** A bump allocator over one block, which places everything allocated from it next to each other.
+ * Freeing single allocations does nothing, everything is freed at once with `ra_arena_reset` or
+ * `ra_arena_free`. Allocating more than the capacity is out of memory. The arena must not be moved
+ * after it has been allocated from, since objects keep a pointer to it. */
+typedef struct {
+    raAllocator allocator;
+    unsigned char* data;
+    size_t capacity;
+    size_t used;
+    /** Allocations since the arena was made or last reset */
+    size_t num_allocations;
+} raArena;
+
+void ra_arena_init(raArena* arena, size_t capacity);
+/** Frees everything allocated from the arena, keeping the block for reuse */
+void ra_arena_reset(raArena* arena);
+/** Moves on to the next multiple of `align`, a power of two, so the next allocation starts there
+ * whatever its own alignment. Moves to the end if that is past it. */
+void ra_arena_align(raArena* arena, size_t align);
+void ra_arena_free(raArena* arena);
+
+#endif /* RA_ALLOC_H */
@@ -0,0 +1,19 @@
+#ifndef RA_BENCH_BENCH_H
+#define RA_BENCH_BENCH_H
+#include <stdio.h>
+#include <time.h>
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void bench_report(const char* name, double seconds, size_t iterations)
+{
+    printf("%-32s %10.2f ns/iter (%zu iterations, %.3f s)\n", name,
+        seconds * 1e9 / (double)iterations, iterations, seconds);
+}
+
+#endif // RA_BENCH_BENCH_H
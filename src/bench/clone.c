@@ -0,0 +1,59 @@
+#include "../alloc.h"
+#include "../powertrain.h"
+#include "../powertrainabs.h"
+#include "../wheel.h"
+#include "../tests/test.h"
+#include "bench.h"
+#include <assert.h>
+
+#define NUM_CLONES 10000
+
+int main(void)
+{
+    raTaggedComponent* engine = ra_tag_engine(test_engine());
+    float clutch_normal_force;
+    raTaggedComponent* clutch = ra_tag_clutch(clutch_with_torque(&clutch_normal_force, 300, 240));
+    raTaggedComponent* gb = ra_tag_gearbox(test_gearbox());
+    raTaggedComponent* diff = ra_tag_differential(differential_new(3.2, 0.18, DiffTypeLocked));
+    assert(ra_tagged_add_next(engine, clutch) == 0);
+    assert(ra_tagged_add_next(clutch, gb) == 0);
+    assert(ra_tagged_add_next(gb, diff) == 0);
+    Wheel* left = wheel_new(0.6, 0.344, vector2f_default(), 0.1);
+    Wheel* right = wheel_new(0.6, 0.344, vector2f_default(), 0.1);
+    assert(ra_tagged_add_next_left(diff, ra_tag_wheel(left)) == 0);
+    assert(ra_tagged_add_next_right(diff, ra_tag_wheel(right)) == 0);
+    raPowertrainSystem sys = RA_POWERTRAIN_SYSTEM(engine);
+
+    static raPowertrainSystem clones[NUM_CLONES];
+    const char* names[] = { "  clone deep", "  clone shared" };
+    printf("%d rear wheel drive vehicles\n", NUM_CLONES);
+
+    for (int share = 0; share < 2; share++) {
+        double start = bench_now();
+        for (size_t i = 0; i < NUM_CLONES; i++) {
+            ra_powertrain_system_clone(sys, &ra_heap_allocator, share, &clones[i]);
+        }
+        bench_report(names[share], bench_now() - start, NUM_CLONES);
+
+        for (size_t i = 0; i < NUM_CLONES; i++) {
+            ra_powertrain_system_free(clones[i]);
+        }
+    }
+
+    raArena arena;
+    ra_arena_init(&arena, (size_t)NUM_CLONES * 2048);
+    for (int share = 0; share < 2; share++) {
+        double start = bench_now();
+        for (size_t i = 0; i < NUM_CLONES; i++) {
+            ra_powertrain_system_clone(sys, &arena.allocator, share, &clones[i]);
+        }
+        bench_report(share ? "  clone shared, arena" : "  clone deep, arena",
+            bench_now() - start, NUM_CLONES);
+        printf("  %zu bytes per vehicle\n", arena.used / NUM_CLONES);
+        ra_arena_reset(&arena);
+    }
+
+    ra_arena_free(&arena);
+    ra_powertrain_system_free(sys);
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "../executor.h"
+#include "../vehicle.h"
+#include "../tests/test.h"
+#include "bench.h"
+#include <assert.h>
+#include <stdlib.h>
+
+#define NUM_VEHICLES 5000
+#define NUM_STEPS 200
+
+/** Half the vehicles slip their clutch and some brake with the ABS */
+static raInputs inputs(size_t step, size_t vehicle)
+{
+    bool braking = step > 100 && vehicle % 4 == 0;
+    float engaged = vehicle % 2 == 0 ? 20.0f : 200.0f;
+    return (raInputs) {
+        .throttle = braking ? 0.0f : 0.7f,
+        .brake = braking ? 1.0f : 0.0f,
+        .clutch = (float)step < engaged ? 1.0f - (float)step / engaged : 0.0f,
+        .steering = 0.002f * (float)(vehicle % 100),
+    };
+}
+
+/** Steps with 1 to `argv[1]` threads, 8 by default */
+int main(int argc, char** argv)
+{
+    size_t max_threads = argc > 1 ? strtoul(argv[1], NULL, 10) : 8;
+    TireModel model = test_tire_model();
+    raVehicleParams params = test_vehicle_params(&model);
+    raVehicle v;
+    assert(ra_vehicle_init(&v, &params, test_vehicle_parts(&params)) == 0);
+
+    raVehicle* vehicles = ra_alloc_aligned(
+        &ra_heap_allocator, NUM_VEHICLES * sizeof(raVehicle), RA_CACHE_LINE);
+    static raInputs in[NUM_VEHICLES];
+    float dt = 1.0f / 200.0f;
+    float sink = 0.0f;
+    double single = 0.0;
+    printf("%d vehicles\n", NUM_VEHICLES);
+
+    for (size_t threads = 1; threads <= max_threads; threads++) {
+        raArena arena;
+        assert(ra_vehicle_clone_aligned(&v, NUM_VEHICLES, &arena, vehicles) == 0);
+        raExecutor e;
+        ra_executor_init(&e, threads);
+
+        double start = bench_now();
+        for (size_t step = 0; step < NUM_STEPS; step++) {
+            for (size_t i = 0; i < NUM_VEHICLES; i++) {
+                in[i] = inputs(step, i);
+            }
+            ra_executor_step(&e, vehicles, in, NUM_VEHICLES, dt);
+        }
+        double seconds = bench_now() - start;
+        single = threads == 1 ? seconds : single;
+
+        char name[32];
+        snprintf(name, sizeof name, "  %zu threads", e.num_threads);
+        bench_report(name, seconds, NUM_STEPS * NUM_VEHICLES);
+        printf("    %.2fx, %.2f ms per step\n", single / seconds, seconds * 1e3 / NUM_STEPS);
+
+        ra_executor_free(&e);
+        for (size_t i = 0; i < NUM_VEHICLES; i++) {
+            sink += vehicles[i].position.x;
+        }
+        ra_arena_free(&arena);
+    }
+    printf("(%f)\n", sink);
+
+    ra_free(&ra_heap_allocator, vehicles);
+    ra_vehicle_free(&v);
+    return 0;
+}
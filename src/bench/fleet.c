@@ -0,0 +1,68 @@
+#include "../fleet.h"
+#include "../vehicle.h"
+#include "../tests/test.h"
+#include "bench.h"
+#include <assert.h>
+
+#define NUM_VEHICLES 1000
+#define NUM_STEPS 500
+
+static raInputs inputs(size_t step, size_t vehicle)
+{
+    return (raInputs) {
+        .throttle = 0.6f,
+        .brake = 0.0f,
+        .clutch = step < 100 ? 1.0f - (float)step / 100.0f : 0.0f,
+        .steering = 0.002f * (float)(vehicle % 100),
+    };
+}
+
+int main(void)
+{
+    TireModel model = test_tire_model();
+    raVehicleParams params = test_vehicle_params(&model);
+    raVehicle v;
+    assert(ra_vehicle_init(&v, &params, test_vehicle_parts(&params)) == 0);
+
+    static raVehicle vehicles[NUM_VEHICLES];
+    for (size_t i = 0; i < NUM_VEHICLES; i++) {
+        assert(ra_vehicle_clone(&v, &ra_heap_allocator, &vehicles[i]) == 0);
+    }
+    raFleet fleet;
+    ra_fleet_init(&fleet, &v, NUM_VEHICLES);
+
+    static raInputs in[NUM_VEHICLES];
+    float dt = 1.0f / 200.0f;
+    float sink = 0.0f;
+    printf("%d vehicles\n", NUM_VEHICLES);
+
+    double start = bench_now();
+    for (size_t step = 0; step < NUM_STEPS; step++) {
+        for (size_t i = 0; i < NUM_VEHICLES; i++) {
+            in[i] = inputs(step, i);
+            ra_vehicle_step(&vehicles[i], &in[i], dt);
+        }
+    }
+    bench_report("  one at a time", bench_now() - start, NUM_STEPS * NUM_VEHICLES);
+
+    start = bench_now();
+    for (size_t step = 0; step < NUM_STEPS; step++) {
+        for (size_t i = 0; i < NUM_VEHICLES; i++) {
+            in[i] = inputs(step, i);
+        }
+        ra_fleet_step(&fleet, in, dt);
+    }
+    bench_report("  fleet", bench_now() - start, NUM_STEPS * NUM_VEHICLES);
+
+    for (size_t i = 0; i < NUM_VEHICLES; i++) {
+        sink += vehicles[i].position.x - fleet.position_x[i];
+    }
+    printf("(%f)\n", sink);
+
+    for (size_t i = 0; i < NUM_VEHICLES; i++) {
+        ra_vehicle_free(&vehicles[i]);
+    }
+    ra_fleet_free(&fleet);
+    ra_vehicle_free(&v);
+    return 0;
+}
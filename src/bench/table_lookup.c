@@ -0,0 +1,82 @@
+#include "../common.h"
+#include "../tests/test.h"
+#include "bench.h"
+#include <stdlib.h>
+
+#define NUM_QUERIES 512
+#define NUM_ROUNDS 20000
+
+int main(void)
+{
+    Engine* engine = test_engine();
+    const Table* table = &engine->torque_map;
+    Table uniform = table_resample_uniform(table, 11, 121);
+
+    float x[NUM_QUERIES], y[NUM_QUERIES], out[NUM_QUERIES];
+    srand(1);
+    for (size_t i = 0; i < NUM_QUERIES; i++) {
+        x[i] = (float)rand() / (float)RAND_MAX;
+        y[i] = (float)rand() / (float)RAND_MAX * 650.0f;
+    }
+
+    const Table* tables[] = { table, &uniform };
+    const char* names[] = { "engine map", "uniform 11x121" };
+    float sink = 0.0f;
+
+    for (size_t t = 0; t < 2; t++) {
+        printf("%s\n", names[t]);
+
+        double start = bench_now();
+        for (size_t r = 0; r < NUM_ROUNDS; r++) {
+            for (size_t i = 0; i < NUM_QUERIES; i++) {
+                out[i] = table_lookup(tables[t], x[i], y[i]);
+            }
+            sink += out[r % NUM_QUERIES];
+        }
+        bench_report("  table_lookup", bench_now() - start, NUM_ROUNDS * NUM_QUERIES);
+
+        start = bench_now();
+        for (size_t r = 0; r < NUM_ROUNDS; r++) {
+            table_lookup_n_scalar(tables[t], x, y, out, NUM_QUERIES);
+            sink += out[r % NUM_QUERIES];
+        }
+        bench_report("  table_lookup_n_scalar", bench_now() - start, NUM_ROUNDS * NUM_QUERIES);
+
+        start = bench_now();
+        for (size_t r = 0; r < NUM_ROUNDS; r++) {
+            table_lookup_n(tables[t], x, y, out, NUM_QUERIES);
+            sink += out[r % NUM_QUERIES];
+        }
+        bench_report("  table_lookup_n", bench_now() - start, NUM_ROUNDS * NUM_QUERIES);
+    }
+
+    // Smooth rpm sweep on a map with 50 rpm breakpoints, as an engine sees it between steps
+    Table fine = table_resample_uniform(table, 2, 128);
+    fine.y_uniform = false;
+    TableCursor cursor = table_cursor_new();
+    printf("smooth sweep, 2x128\n");
+
+    double start = bench_now();
+    for (size_t r = 0; r < NUM_ROUNDS; r++) {
+        for (size_t i = 0; i < NUM_QUERIES; i++) {
+            sink += table_lookup(&fine, 1.0, (float)i * 1.2f);
+        }
+    }
+    bench_report("  table_lookup", bench_now() - start, NUM_ROUNDS * NUM_QUERIES);
+
+    start = bench_now();
+    for (size_t r = 0; r < NUM_ROUNDS; r++) {
+        for (size_t i = 0; i < NUM_QUERIES; i++) {
+            sink += table_lookup_cursor(&fine, &cursor, 1.0, (float)i * 1.2f);
+        }
+    }
+    bench_report("  table_lookup_cursor", bench_now() - start, NUM_ROUNDS * NUM_QUERIES);
+
+    printf("(%f)\n", sink);
+
+    table_free(&fine);
+
+    table_free(&uniform);
+    engine_free(engine);
+    return 0;
+}
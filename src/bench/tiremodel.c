@@ -0,0 +1,99 @@
+#include "../wheel.h"
+#include "../tests/test.h"
+#include "bench.h"
+#include <stdlib.h>
+
+#define NUM_QUERIES 512
+#define NUM_ROUNDS 5000
+
+int main(void)
+{
+    TireModel model = test_tire_model();
+
+    float ratio[NUM_QUERIES], angle[NUM_QUERIES];
+    srand(1);
+    for (size_t i = 0; i < NUM_QUERIES; i++) {
+        ratio[i] = ((float)rand() / (float)RAND_MAX - 0.5f) * 0.6f;
+        angle[i] = ((float)rand() / (float)RAND_MAX - 0.5f) * 0.5f;
+    }
+
+    TireModelAccuracy accuracies[] = { TireModelAccuracyExact, TireModelAccuracyFast };
+    const char* names[] = { "tiremodel_force exact", "tiremodel_force fast" };
+    float sink = 0.0f;
+
+    for (size_t a = 0; a < 2; a++) {
+        model.accuracy = accuracies[a];
+
+        double start = bench_now();
+        for (size_t r = 0; r < NUM_ROUNDS; r++) {
+            for (size_t i = 0; i < NUM_QUERIES; i++) {
+                Vector2f f = tiremodel_force(&model, 4000.0, ratio[i], angle[i], 1.0);
+                sink += f.x + f.y;
+            }
+        }
+        bench_report(names[a], bench_now() - start, NUM_ROUNDS * NUM_QUERIES);
+    }
+
+    model.accuracy = TireModelAccuracyExact;
+    tiremodel_enable_surface(&model, &ra_heap_allocator, tire_surface_config_default());
+    tiremodel_build_surface(&model);
+
+    double start = bench_now();
+    for (size_t r = 0; r < NUM_ROUNDS; r++) {
+        for (size_t i = 0; i < NUM_QUERIES; i++) {
+            Vector2f f = tiremodel_force(&model, 4000.0, ratio[i], angle[i], 1.0);
+            sink += f.x + f.y;
+        }
+    }
+    bench_report("tiremodel_force surface", bench_now() - start, NUM_ROUNDS * NUM_QUERIES);
+    tiremodel_disable_surface(&model);
+
+    // Four corners at a time, with the rotation to the body frame
+    Wheel* wheels[4];
+    for (int l = 0; l < 4; l++) {
+        wheels[l] = wheel_new(0.6, 0.344, vector2f_default(), 0.1);
+    }
+
+    float fz[4] = { 4000.0, 4000.0, 3500.0, 3500.0 };
+    float mu[4] = { 1.0, 1.0, 1.0, 1.0 };
+    printf("four corners, per wheel\n");
+    const char* corner_names[] = { "  wheel_force x4 exact", "  wheel_force_4 exact",
+        "  wheel_force x4 fast", "  wheel_force_4 fast" };
+
+    for (size_t a = 0; a < 2; a++) {
+        model.accuracy = accuracies[a];
+
+        for (int batched = 0; batched < 2; batched++) {
+            double start = bench_now();
+            for (size_t r = 0; r < NUM_ROUNDS; r++) {
+                for (size_t i = 0; i + 4 <= NUM_QUERIES; i += 4) {
+                    for (int l = 0; l < 4; l++) {
+                        wheels[l]->hub_velocity = (Vector2f) { .x = 20.0f, .y = angle[i + l] };
+                        wheels[l]->angular_velocity = 58.0f * (1.0f + ratio[i + l]);
+                        wheels[l]->angle = angle[i + l] * 0.1f;
+                    }
+
+                    Vector2f f[4];
+                    if (batched) {
+                        wheel_force_4(wheels, &model, fz, mu, f);
+                    } else {
+                        for (int l = 0; l < 4; l++) {
+                            f[l] = vector2f_rotate(
+                                wheel_force(wheels[l], &model, fz[l], mu[l]), -wheels[l]->angle);
+                        }
+                    }
+                    sink += f[0].x + f[1].y + f[2].x + f[3].y;
+                }
+            }
+            bench_report(
+                corner_names[a * 2 + batched], bench_now() - start, NUM_ROUNDS * NUM_QUERIES);
+        }
+    }
+
+    for (int l = 0; l < 4; l++) {
+        free(wheels[l]);
+    }
+
+    printf("(%f)\n", sink);
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include "../alloc.h"
+#include "../powertrain.h"
+#include "../powertrainabs.h"
+#include "../wheel.h"
+#include "../tests/test.h"
+#include "bench.h"
+#include <assert.h>
+
+#define NUM_VEHICLES 1000
+#define NUM_STEPS 500
+
+typedef struct {
+    Engine* engine;
+    Wheel* wheels[4];
+    raPowertrainSystem sys;
+    raPowertrainSchedule schedule;
+} Vehicle;
+
+/** Rear wheel drive, with the front wheels as their own subsystems */
+static Vehicle vehicle_new(void)
+{
+    Vehicle v;
+    v.engine = test_engine();
+    v.engine->angular_velocity = 150.0f;
+    float clutch_normal_force;
+    raTaggedComponent* engine = ra_tag_engine(v.engine);
+    raTaggedComponent* clutch = ra_tag_clutch(clutch_with_torque(&clutch_normal_force, 300, 240));
+    ((ClutchTagged*)ra_tagged_component_inner(clutch))->curr_normal_force = clutch_normal_force;
+    Gearbox* gb = test_gearbox();
+    gb->curr_gear = 2;
+    raTaggedComponent* c_gb = ra_tag_gearbox(gb);
+    raTaggedComponent* diff = ra_tag_differential(differential_new(3.2, 0.18, DiffTypeOpen));
+    assert(ra_tagged_add_next(engine, clutch) == 0);
+    assert(ra_tagged_add_next(clutch, c_gb) == 0);
+    assert(ra_tagged_add_next(c_gb, diff) == 0);
+
+    float x[4] = { 1.2f, 1.2f, -1.5f, -1.5f };
+    float y[4] = { 0.8f, -0.8f, 0.8f, -0.8f };
+    raTaggedComponent* c_wheels[4];
+    for (int i = 0; i < 4; i++) {
+        v.wheels[i] = wheel_new(0.6, 0.344, (Vector2f) { .x = x[i], .y = y[i] }, 0.1);
+        c_wheels[i] = ra_tag_wheel(v.wheels[i]);
+    }
+    assert(ra_tagged_add_next_left(diff, c_wheels[2]) == 0);
+    assert(ra_tagged_add_next_right(diff, c_wheels[3]) == 0);
+
+    v.sys = RA_POWERTRAIN_SYSTEM(engine, c_wheels[0], c_wheels[1]);
+    assert(ra_powertrain_schedule_compile(v.sys, &ra_heap_allocator, &v.schedule) == 0);
+    return v;
+}
+
+int main(void)
+{
+    TireModel model = test_tire_model();
+
+    static Vehicle vehicles[NUM_VEHICLES];
+    for (size_t i = 0; i < NUM_VEHICLES; i++) {
+        vehicles[i] = vehicle_new();
+    }
+
+    float fz[4] = { 3500.0f, 3500.0f, 4000.0f, 4000.0f };
+    float mu[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    raVelocities vel = { .velocity_cog = { .x = 10.0, .y = 0.5 }, .yaw_velocity_cog = 0.05 };
+    float dt = 1.0f / 200.0f;
+    float sink = 0.0f;
+
+    double start = bench_now();
+    for (size_t step = 0; step < NUM_STEPS; step++) {
+        for (size_t i = 0; i < NUM_VEHICLES; i++) {
+            Vehicle* v = &vehicles[i];
+            float torque = engine_torque(v->engine, 0.6f);
+            ra_powertrain_schedule_send_torque(&v->schedule, 0, torque, vel, dt);
+            ra_powertrain_schedule_send_torque(&v->schedule, 1, 0.0f, vel, dt);
+            ra_powertrain_schedule_send_torque(&v->schedule, 2, 0.0f, vel, dt);
+            ra_powertrain_schedule_update_angular_velocity(&v->schedule);
+
+            Vector2f force[4];
+            wheel_force_4(v->wheels, &model, fz, mu, force);
+            sink += force[0].x + force[3].y;
+        }
+    }
+    printf("%d rear wheel drive vehicles\n", NUM_VEHICLES);
+    bench_report("  vehicle step", bench_now() - start, NUM_STEPS * NUM_VEHICLES);
+
+    printf("(%f)\n", sink);
+
+    for (size_t i = 0; i < NUM_VEHICLES; i++) {
+        ra_powertrain_schedule_free(&vehicles[i].schedule);
+        ra_powertrain_system_free(vehicles[i].sys);
+    }
+
+    return 0;
+}
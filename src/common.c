@@ -1,10 +1,13 @@
 #include "common.h"
+#include "simd.h"
 #include <assert.h>
 #include <math.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 inline float rads_to_rpm(AngularVelocity rads) { return rads * 60.0 / (2.0 * M_PI); }
 inline float rpm_to_rads(AngularVelocity rpm) { return 2.0 * M_PI * rpm / 60.0; }
@@ -54,80 +57,221 @@ float signum(float v) { return (copysignf(1.0, v)); }
 
 VecFloat vec_with_capacity(int capacity)
 {
-    float* elements = malloc(sizeof *elements * capacity);
-    if (elements == NULL) {
-        abort();
-    }
+    return vec_with_capacity_in(&ra_heap_allocator, capacity);
+}
 
-    return (VecFloat) { .elements = elements, .capacity = capacity, .len = 0 };
+VecFloat vec_with_capacity_in(raAllocator* a, int capacity)
+{
+    float* elements = ra_alloc(a, sizeof *elements * capacity);
+    return (VecFloat) { .elements = elements, .capacity = capacity, .len = 0, .allocator = a };
 }
 
 void vec_push_float(VecFloat* v, float element)
 {
     if (v->capacity == v->len) {
-        v->capacity *= 2;
-        v->elements = realloc(v->elements, sizeof *v->elements * v->capacity);
-        if (v->elements == NULL) {
-            exit(EXIT_FAILURE);
-        }
+        size_t capacity = v->capacity > 0 ? v->capacity * 2 : 1;
+        float* elements = ra_alloc(v->allocator, sizeof *elements * capacity);
+        memcpy(elements, v->elements, sizeof *elements * v->len);
+        ra_free(v->allocator, v->elements);
+        v->elements = elements;
+        v->capacity = capacity;
     }
 
     v->elements[v->len] = element;
     v->len += 1;
 }
 
+VecFloat vec_clone_in(raAllocator* a, const VecFloat* v)
+{
+    VecFloat clone = vec_with_capacity_in(a, (int)v->capacity);
+    memcpy(clone.elements, v->elements, sizeof *v->elements * v->len);
+    clone.len = v->len;
+    return clone;
+}
+
+VecFloat vec_borrow(const VecFloat* v)
+{
+    VecFloat view = *v;
+    view.allocator = NULL;
+    return view;
+}
+
 void vec_free(VecFloat* v)
 {
-    free(v->elements);
+    if (v->allocator != NULL) {
+        ra_free(v->allocator, v->elements);
+    }
     v->elements = NULL;
     v->capacity = 0;
     v->len = 0;
 }
 
 Table table_with_capacity(size_t x_elements, size_t y_elements)
+{
+    return table_with_capacity_in(&ra_heap_allocator, x_elements, y_elements);
+}
+
+Table table_with_capacity_in(raAllocator* a, size_t x_elements, size_t y_elements)
 {
     assert(x_elements >= 2 && y_elements >= 2);
-    float* x = malloc(x_elements * sizeof *x);
-    if (x == NULL) {
-        exit(EXIT_FAILURE);
-    }
+    float* x = ra_alloc(a, (x_elements + y_elements + x_elements * y_elements) * sizeof *x);
+
+    float* y = x + x_elements;
+    float* z = y + y_elements;
+
+    return (Table) {
+        .x = x,
+        .y = y,
+        .z = z,
+        .x_capacity = x_elements,
+        .y_capacity = y_elements,
+        .x_uniform = false,
+        .y_uniform = false,
+        .x_inv_step = 0.0f,
+        .y_inv_step = 0.0f,
+        .owned = true,
+        .allocator = a,
+    };
+}
 
-    float* y = malloc(y_elements * sizeof *y);
-    if (y == NULL) {
-        exit(EXIT_FAILURE);
+static float uniform_axis(float* elements, size_t num_elements, float min, float max)
+{
+    assert(max > min);
+    float step = (max - min) / (float)(num_elements - 1);
+    for (size_t i = 0; i < num_elements - 1; i++) {
+        elements[i] = min + step * (float)i;
     }
+    // Avoid accumulated rounding at the end so the range is exactly [min, max]
+    elements[num_elements - 1] = max;
 
-    float** z = malloc(x_elements * sizeof *z);
-    if (z == NULL) {
-        exit(EXIT_FAILURE);
-    }
+    return 1.0f / step;
+}
+
+Table table_uniform_with_capacity(
+    size_t x_elements, float x_min, float x_max, size_t y_elements, float y_min, float y_max)
+{
+    return table_uniform_with_capacity_in(
+        &ra_heap_allocator, x_elements, x_min, x_max, y_elements, y_min, y_max);
+}
+
+Table table_uniform_with_capacity_in(raAllocator* a, size_t x_elements, float x_min, float x_max,
+    size_t y_elements, float y_min, float y_max)
+{
+    Table table = table_with_capacity_in(a, x_elements, y_elements);
+    table.x_inv_step = uniform_axis(table.x, x_elements, x_min, x_max);
+    table.y_inv_step = uniform_axis(table.y, y_elements, y_min, y_max);
+    table.x_uniform = true;
+    table.y_uniform = true;
+    return table;
+}
+
+Table table_resample_uniform(const Table* table, size_t x_elements, size_t y_elements)
+{
+    Table t = table_uniform_with_capacity(x_elements, table->x[0],
+        table->x[table->x_capacity - 1], y_elements, table->y[0], table->y[table->y_capacity - 1]);
 
     for (size_t i = 0; i < x_elements; i++) {
-        z[i] = malloc(y_elements * sizeof **z);
-        if (z[i] == NULL) {
-            exit(EXIT_FAILURE);
+        for (size_t j = 0; j < y_elements; j++) {
+            table_set(&t, i, j, table_lookup(table, t.x[i], t.y[j]));
         }
     }
 
-    return (Table) { .x = x, .y = y, .z = z, .x_capacity = x_elements, .y_capacity = y_elements };
+    return t;
 }
 
-void table_free(Table* table)
+/**
+ * Whether the breakpoints are evenly spaced, within rounding. It only needs to be close since
+ * `uniform_start` is just a starting guess, but a poor guess makes lookups walk further.
+ */
+static bool detect_uniform(const float* elements, size_t num_elements, float* inv_step)
 {
-    free(table->x);
-    free(table->y);
+    float step = (elements[num_elements - 1] - elements[0]) / (float)(num_elements - 1);
+    if (!(step > 0.0f)) {
+        return false;
+    }
 
-    for (size_t i = 0; i < table->x_capacity; i++) {
-        free(table->z[i]);
+    for (size_t i = 1; i < num_elements - 1; i++) {
+        if (fabsf(elements[i] - (elements[0] + step * (float)i)) > step * 1e-3f) {
+            return false;
+        }
     }
 
-    free(table->z);
+    *inv_step = 1.0f / step;
+    return true;
+}
+
+Table table_view(
+    size_t x_elements, const float* x, size_t y_elements, const float* y, const float* z)
+{
+    assert(x_elements >= 2 && y_elements >= 2);
+    // The pointers are not const in Table since owned tables are writable. Views are read-only
+    // unless the caller knows better.
+    Table table = {
+        .x = (float*)x,
+        .y = (float*)y,
+        .z = (float*)z,
+        .x_capacity = x_elements,
+        .y_capacity = y_elements,
+        .x_inv_step = 0.0f,
+        .y_inv_step = 0.0f,
+        .owned = false,
+    };
+    table.x_uniform = detect_uniform(x, x_elements, &table.x_inv_step);
+    table.y_uniform = detect_uniform(y, y_elements, &table.y_inv_step);
+
+    return table;
+}
+
+Table table_borrow(const Table* table)
+{
+    Table view = *table;
+    view.owned = false;
+    return view;
+}
+
+Table table_clone_in(raAllocator* a, const Table* table)
+{
+    size_t nx = table->x_capacity;
+    size_t ny = table->y_capacity;
+    Table clone = table_with_capacity_in(a, nx, ny);
+    // Views do not need to be contiguous, so each part is copied on its own
+    memcpy(clone.x, table->x, nx * sizeof *clone.x);
+    memcpy(clone.y, table->y, ny * sizeof *clone.y);
+    memcpy(clone.z, table->z, nx * ny * sizeof *clone.z);
+    clone.x_uniform = table->x_uniform;
+    clone.y_uniform = table->y_uniform;
+    clone.x_inv_step = table->x_inv_step;
+    clone.y_inv_step = table->y_inv_step;
+    return clone;
+}
+
+void table_free(Table* table)
+{
+    if (table->owned) {
+        // y and z are part of the same allocation
+        ra_free(table->allocator, table->x);
+    }
 
     table->x = NULL;
     table->y = NULL;
     table->z = NULL;
     table->x_capacity = 0;
     table->y_capacity = 0;
+    table->x_uniform = false;
+    table->y_uniform = false;
+    table->owned = false;
+}
+
+float table_get(const Table* table, size_t xi, size_t yi)
+{
+    assert(xi < table->x_capacity && yi < table->y_capacity);
+    return table->z[xi * table->y_capacity + yi];
+}
+
+void table_set(Table* table, size_t xi, size_t yi, float z)
+{
+    assert(xi < table->x_capacity && yi < table->y_capacity);
+    table->z[xi * table->y_capacity + yi] = z;
 }
 
 static inline float linear_interpolation(float x1, float x2, float x3, float y1, float y3)
@@ -136,51 +280,303 @@ static inline float linear_interpolation(float x1, float x2, float x3, float y1,
 }
 
 /**
- * find two values on each side of a value
+ * Index of the first element that is >= value, or num_elements if there is none. The search
+ * starts at `start` and walks in whichever direction is needed.
  */
-static void boundary_values(float value, const float* elements, size_t num_elements,
-    size_t* index_below, size_t* index_above)
-{
-    bool found = false;
-    for (size_t i = 0; i < num_elements; ++i) {
-        if (elements[i] >= value) {
-            if (i == 0) {
-                *index_below = 0;
-                *index_above = 1;
-            } else {
-                *index_below = i - 1;
-                *index_above = i;
-            }
-
-            found = true;
-            break;
-        }
+static size_t bracket_walk(float value, const float* elements, size_t num_elements, size_t start)
+{
+    size_t i = start;
+    while (i > 0 && elements[i - 1] >= value) {
+        --i;
     }
 
-    if (!found) {
+    while (i < num_elements && elements[i] < value) {
+        ++i;
+    }
+
+    return i;
+}
+
+/**
+ * Starting guess for `bracket_walk` on an evenly spaced axis. The walk then moves at most a step
+ * or two to correct for truncation and rounding, so the resulting cell is always the same as a
+ * full scan.
+ */
+static size_t uniform_start(float value, const float* elements, size_t num_elements, float inv_step)
+{
+    float pos = (value - elements[0]) * inv_step;
+    if (!(pos > 0.0f)) {
+        return 0;
+    } else if (pos >= (float)num_elements) {
+        return num_elements;
+    } else {
+        return (size_t)pos;
+    }
+}
+
+/**
+ * find two values on each side of a value. `start` is where the search begins, on return it is
+ * the index the search ended at, which is a good start for a nearby value.
+ */
+static void boundary_values(float value, const float* elements, size_t num_elements,
+    bool is_uniform, float inv_step, size_t* start, size_t* index_below, size_t* index_above)
+{
+    size_t s = is_uniform ? uniform_start(value, elements, num_elements, inv_step)
+                          : (*start > num_elements ? num_elements : *start);
+    size_t i = bracket_walk(value, elements, num_elements, s);
+    *start = i;
+
+    if (i == 0) {
+        *index_below = 0;
+        *index_above = 1;
+    } else if (i == num_elements) {
         *index_below = num_elements - 2;
         *index_above = num_elements - 1;
+    } else {
+        *index_below = i - 1;
+        *index_above = i;
     }
 }
 
-float table_lookup(const Table* table, float x, float y)
+/** The four corners of the cell surrounding a lookup and the breakpoints on each side */
+typedef struct {
+    float below_x, above_x;
+    float below_y, above_y;
+    float z00, z01, z10, z11;
+} TableCell;
+
+static inline TableCell table_cell(const Table* table, TableCursor* cursor, float x, float y)
 {
     size_t below_xi, above_xi;
-    boundary_values(x, table->x, table->x_capacity, &below_xi, &above_xi);
+    boundary_values(x, table->x, table->x_capacity, table->x_uniform, table->x_inv_step,
+        &cursor->xi, &below_xi, &above_xi);
 
     size_t below_yi, above_yi;
-    boundary_values(y, table->y, table->y_capacity, &below_yi, &above_yi);
+    boundary_values(y, table->y, table->y_capacity, table->y_uniform, table->y_inv_step,
+        &cursor->yi, &below_yi, &above_yi);
+
+    const float* below_row = table->z + below_xi * table->y_capacity;
+    const float* above_row = table->z + above_xi * table->y_capacity;
+
+    return (TableCell) {
+        .below_x = table->x[below_xi],
+        .above_x = table->x[above_xi],
+        .below_y = table->y[below_yi],
+        .above_y = table->y[above_yi],
+        .z00 = below_row[below_yi],
+        .z01 = below_row[above_yi],
+        .z10 = above_row[below_yi],
+        .z11 = above_row[above_yi],
+    };
+}
+
+static inline float table_cell_interpolate(const TableCell* c, float x, float y)
+{
+    float lower_z = linear_interpolation(c->below_y, y, c->above_y, c->z00, c->z01);
+    float upper_z = linear_interpolation(c->below_y, y, c->above_y, c->z10, c->z11);
+
+    return linear_interpolation(c->below_x, x, c->above_x, lower_z, upper_z);
+}
+
+TableCursor table_cursor_new(void) { return (TableCursor) { .xi = 0, .yi = 0 }; }
+
+float table_lookup(const Table* table, float x, float y)
+{
+    TableCursor cursor = table_cursor_new();
+    TableCell c = table_cell(table, &cursor, x, y);
+    return table_cell_interpolate(&c, x, y);
+}
+
+float table_lookup_cursor(const Table* table, TableCursor* cursor, float x, float y)
+{
+    TableCell c = table_cell(table, cursor, x, y);
+    return table_cell_interpolate(&c, x, y);
+}
+
+size_t table_find_x(const Table* table, TableCursor* cursor, float x)
+{
+    size_t below, above;
+    boundary_values(x, table->x, table->x_capacity, table->x_uniform, table->x_inv_step,
+        &cursor->xi, &below, &above);
+    return below;
+}
+
+size_t table_find_y(const Table* table, TableCursor* cursor, float y)
+{
+    size_t below, above;
+    boundary_values(y, table->y, table->y_capacity, table->y_uniform, table->y_inv_step,
+        &cursor->yi, &below, &above);
+    return below;
+}
+
+#ifdef RA_SIMD_X86
+// The AVX2 kernel finds the cells of eight lookups at once. On evenly spaced axes the start of the
+// search is computed like uniform_start and corrected by a fixed number of steps, instead of
+// walking one lookup at a time. Other axes are still searched lane by lane. The index math and the
+// interpolation are the same IEEE single precision operations in the same order as table_lookup,
+// so every lane gives exactly the same result.
+
+/** Same as `boundary_values` with a new cursor for each lane, giving the index below. Returns
+ * false if a lane needs a longer search than the fixed steps, which only happens for NaN. */
+RA_TARGET_AVX2 static bool axis_below_avx2(const float* elements, size_t num_elements,
+    bool is_uniform, float inv_step, __m256 value, __m256i* below)
+{
+    if (!is_uniform) {
+        float lanes[8];
+        int32_t indices[8];
+        _mm256_storeu_ps(lanes, value);
+        for (int l = 0; l < 8; l++) {
+            size_t start = 0, index_below, index_above;
+            boundary_values(lanes[l], elements, num_elements, false, 0.0f, &start, &index_below,
+                &index_above);
+            indices[l] = (int32_t)index_below;
+        }
+        *below = _mm256_loadu_si256((const __m256i*)indices);
+        return true;
+    }
+
+    __m256i zero = _mm256_setzero_si256();
+    __m256i one = _mm256_set1_epi32(1);
+    __m256i n = _mm256_set1_epi32((int32_t)num_elements);
+
+    // uniform_start. max_ps gives its second operand for NaN, the 0 that uniform_start gives.
+    __m256 pos = _mm256_mul_ps(
+        _mm256_sub_ps(value, _mm256_set1_ps(elements[0])), _mm256_set1_ps(inv_step));
+    pos = _mm256_min_ps(_mm256_max_ps(pos, _mm256_setzero_ps()), _mm256_set1_ps(num_elements));
+    __m256i i = _mm256_cvttps_epi32(pos);
+
+    // bracket_walk, which moves at most a step or two from the uniform start
+    for (int k = 0; k < 2; k++) {
+        __m256i prev_i = _mm256_max_epi32(_mm256_sub_epi32(i, one), zero);
+        __m256 prev = _mm256_i32gather_ps(elements, prev_i, 4);
+        __m256i down = _mm256_and_si256(_mm256_cmpgt_epi32(i, zero),
+            _mm256_castps_si256(_mm256_cmp_ps(prev, value, _CMP_GE_OQ)));
+        i = _mm256_add_epi32(i, down);
+    }
+    for (int k = 0; k < 2; k++) {
+        __m256i curr_i = _mm256_min_epi32(i, _mm256_sub_epi32(n, one));
+        __m256 curr = _mm256_i32gather_ps(elements, curr_i, 4);
+        __m256i up = _mm256_and_si256(_mm256_cmpgt_epi32(n, i),
+            _mm256_castps_si256(_mm256_cmp_ps(curr, value, _CMP_LT_OQ)));
+        i = _mm256_sub_epi32(i, up);
+    }
+
+    // Breakpoints are increasing, so the walk is done where the one before is below the value and
+    // the one at it is not
+    __m256i prev_i = _mm256_max_epi32(_mm256_sub_epi32(i, one), zero);
+    __m256i curr_i = _mm256_min_epi32(i, _mm256_sub_epi32(n, one));
+    __m256 prev = _mm256_i32gather_ps(elements, prev_i, 4);
+    __m256 curr = _mm256_i32gather_ps(elements, curr_i, 4);
+    __m256i done_below = _mm256_or_si256(_mm256_cmpeq_epi32(i, zero),
+        _mm256_castps_si256(_mm256_cmp_ps(prev, value, _CMP_LT_OQ)));
+    __m256i done_above = _mm256_or_si256(_mm256_cmpeq_epi32(i, n),
+        _mm256_castps_si256(_mm256_cmp_ps(curr, value, _CMP_GE_OQ)));
+    if (_mm256_movemask_epi8(_mm256_and_si256(done_below, done_above)) != -1) {
+        return false;
+    }
+
+    // The cell is always between two breakpoints, also outside of the axis
+    __m256i last = _mm256_set1_epi32((int32_t)num_elements - 2);
+    *below = _mm256_min_epi32(_mm256_max_epi32(_mm256_sub_epi32(i, one), zero), last);
+    return true;
+}
 
-    float below_x = table->x[below_xi];
-    float below_y = table->y[below_yi];
-    float above_x = table->x[above_xi];
-    float above_y = table->y[above_yi];
+RA_TARGET_AVX2 static inline __m256 linear_interpolation_avx2(
+    __m256 x1, __m256 x2, __m256 x3, __m256 y1, __m256 y3)
+{
+    __m256 num = _mm256_mul_ps(_mm256_sub_ps(x2, x1), _mm256_sub_ps(y3, y1));
+    return _mm256_add_ps(_mm256_div_ps(num, _mm256_sub_ps(x3, x1)), y1);
+}
+
+RA_TARGET_AVX2 static void table_lookup_n_avx2(
+    const Table* table, const float* x, const float* y, float* out, size_t n)
+{
+    __m256i one = _mm256_set1_epi32(1);
+    __m256i y_capacity = _mm256_set1_epi32((int32_t)table->y_capacity);
+
+    for (; n >= 8; n -= 8, x += 8, y += 8, out += 8) {
+        __m256 vx = _mm256_loadu_ps(x);
+        __m256 vy = _mm256_loadu_ps(y);
+        __m256i below_xi, below_yi;
+        if (!axis_below_avx2(table->x, table->x_capacity, table->x_uniform, table->x_inv_step, vx,
+                &below_xi)
+            || !axis_below_avx2(table->y, table->y_capacity, table->y_uniform,
+                table->y_inv_step, vy, &below_yi)) {
+            table_lookup_n_scalar(table, x, y, out, 8);
+            continue;
+        }
+
+        __m256i above_xi = _mm256_add_epi32(below_xi, one);
+        __m256i above_yi = _mm256_add_epi32(below_yi, one);
+        __m256i below_row = _mm256_mullo_epi32(below_xi, y_capacity);
+        __m256i above_row = _mm256_mullo_epi32(above_xi, y_capacity);
+
+        __m256 below_y = _mm256_i32gather_ps(table->y, below_yi, 4);
+        __m256 above_y = _mm256_i32gather_ps(table->y, above_yi, 4);
+        __m256 z00 = _mm256_i32gather_ps(table->z, _mm256_add_epi32(below_row, below_yi), 4);
+        __m256 z01 = _mm256_i32gather_ps(table->z, _mm256_add_epi32(below_row, above_yi), 4);
+        __m256 z10 = _mm256_i32gather_ps(table->z, _mm256_add_epi32(above_row, below_yi), 4);
+        __m256 z11 = _mm256_i32gather_ps(table->z, _mm256_add_epi32(above_row, above_yi), 4);
+
+        __m256 lower = linear_interpolation_avx2(below_y, vy, above_y, z00, z01);
+        __m256 upper = linear_interpolation_avx2(below_y, vy, above_y, z10, z11);
+        _mm256_storeu_ps(out,
+            linear_interpolation_avx2(_mm256_i32gather_ps(table->x, below_xi, 4), vx,
+                _mm256_i32gather_ps(table->x, above_xi, 4), lower, upper));
+    }
 
-    float lower_z = linear_interpolation(
-        below_y, y, above_y, table->z[below_xi][below_yi], table->z[below_xi][above_yi]);
+    table_lookup_n_scalar(table, x, y, out, n);
+}
+#endif
 
-    float upper_z = linear_interpolation(
-        below_y, y, above_y, table->z[above_xi][below_yi], table->z[above_xi][above_yi]);
+void table_lookup_n_scalar(const Table* table, const float* x, const float* y, float* out, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        out[i] = table_lookup(table, x[i], y[i]);
+    }
+}
+
+void table_lookup_n(const Table* table, const float* x, const float* y, float* out, size_t n)
+{
+#ifdef RA_SIMD_X86
+    // Gathers take 32 bit indices
+    if (ra_simd_has_avx2() && table->x_capacity * table->y_capacity <= INT32_MAX) {
+        table_lookup_n_avx2(table, x, y, out, n);
+        return;
+    }
+#endif
+    table_lookup_n_scalar(table, x, y, out, n);
+}
+
+char* ra_read_file(raAllocator* a, const char* path)
+{
+    FILE* fs = fopen(path, "rb");
+    if (fs == NULL) {
+        return NULL;
+    }
+
+    size_t capacity = 4096;
+    size_t len = 0;
+    char* text = ra_alloc(a, capacity);
+    size_t n;
+    while ((n = fread(text + len, 1, capacity - len - 1, fs)) > 0) {
+        len += n;
+        if (len == capacity - 1) {
+            char* grown = ra_alloc(a, capacity * 2);
+            memcpy(grown, text, len);
+            ra_free(a, text);
+            text = grown;
+            capacity *= 2;
+        }
+    }
+
+    bool failed = ferror(fs);
+    fclose(fs);
+    if (failed) {
+        ra_free(a, text);
+        return NULL;
+    }
 
-    return linear_interpolation(below_x, x, above_x, lower_z, upper_z);
+    text[len] = '\0';
+    return text;
 }
@@ -1,6 +1,8 @@
 #ifndef RA_COMMON_H
 #define RA_COMMON_H
+#include "alloc.h"
 #include <math.h>
+#include <stdbool.h>
 #include <sys/types.h>
 
 #define EPSILON 1.19209290e-07 // From rust stdlib
@@ -44,22 +46,94 @@ typedef struct {
     float* elements;
     size_t capacity;
     size_t len;
+    /** NULL for views made with `vec_borrow` */
+    raAllocator* allocator;
 } VecFloat;
 
 VecFloat vec_with_capacity(int capacity);
+VecFloat vec_with_capacity_in(raAllocator* a, int capacity);
 void vec_push_float(VecFloat* v, float element);
 void vec_free(VecFloat* v);
-
-/** A table with sorted x and y from lowest to highest */
+/** A copy of `v` allocated from `a` */
+VecFloat vec_clone_in(raAllocator* a, const VecFloat* v);
+/** A view of the elements of `v`, which must outlive it. `vec_free` only clears it and it must not
+ * be pushed to. */
+VecFloat vec_borrow(const VecFloat* v);
+
+/** A table with sorted x and y from lowest to highest. The axes and z are stored in a single
+ * allocation, x first, then y, then z in row-major order (one row of y values per x). Views made
+ * with `table_view` point into storage owned by someone else instead. */
 typedef struct {
     size_t x_capacity, y_capacity;
     float* x;
     float* y;
-    float** z;
+    float* z;
+    /** An axis marked as uniform has evenly spaced breakpoints, which lets lookups compute the
+     * cell directly instead of scanning for it. `*_inv_step` is 1 / spacing. */
+    bool x_uniform, y_uniform;
+    float x_inv_step, y_inv_step;
+    /** Whether `table_free` releases the storage. False for views. */
+    bool owned;
+    /** What owned storage was allocated with */
+    raAllocator* allocator;
 } Table;
 
+/** Remembers where the previous lookup ended up. Lookups through a cursor start searching from
+ * there instead of from the start of each axis, which makes them close to constant time when the
+ * inputs change little between calls. A cursor can be used with any table, but it is only useful
+ * when it is kept with the table it is used for. */
+typedef struct {
+    size_t xi, yi;
+} TableCursor;
+
+TableCursor table_cursor_new(void);
+
 Table table_with_capacity(size_t x_elements, size_t y_elements);
+Table table_with_capacity_in(raAllocator* a, size_t x_elements, size_t y_elements);
+/** Creates a table where x and y are already filled with evenly spaced breakpoints from min to
+ * max. Only z needs to be filled in. The axes must not be modified afterwards. */
+Table table_uniform_with_capacity(
+    size_t x_elements, float x_min, float x_max, size_t y_elements, float y_min, float y_max);
+Table table_uniform_with_capacity_in(raAllocator* a, size_t x_elements, float x_min, float x_max,
+    size_t y_elements, float y_min, float y_max);
+/** Samples `table` onto a new uniform table spanning the same range. Breakpoints that fall in
+ * between the original ones are linearly interpolated, so features narrower than the new
+ * spacing are smoothed out. */
+Table table_resample_uniform(const Table* table, size_t x_elements, size_t y_elements);
+/** Wraps existing storage without copying it, for example `static const` arrays, an arena or a
+ * mapped file. x, y and z are laid out like in an owned table but do not need to be contiguous.
+ * The storage must outlive the table, and `table_set` must not be used on it if it is read-only.
+ * Evenly spaced axes are detected and get the uniform fast path. */
+Table table_view(
+    size_t x_elements, const float* x, size_t y_elements, const float* y, const float* z);
+/** A non-owning view of `table`, for sharing one table between several owners such as engines.
+ * `table` must outlive the view. */
+Table table_borrow(const Table* table);
+/** An owned copy of `table`, also of views, allocated from `a` */
+Table table_clone_in(raAllocator* a, const Table* table);
+/** Frees an owned table. Views are only cleared. */
 void table_free(Table* table);
+float table_get(const Table* table, size_t xi, size_t yi);
+void table_set(Table* table, size_t xi, size_t yi, float z);
 float table_lookup(const Table* table, float x, float y);
+/** Same result as `table_lookup`, but starts the search from the cell stored in `cursor` and
+ * updates it. */
+float table_lookup_cursor(const Table* table, TableCursor* cursor, float x, float y);
+/** Index of the breakpoint below `x` in the cell `table_lookup` would use. The breakpoint above
+ * is always the next one. */
+size_t table_find_x(const Table* table, TableCursor* cursor, float x);
+/** Same as `table_find_x` for y */
+size_t table_find_y(const Table* table, TableCursor* cursor, float y);
+/** Same as calling `table_lookup` for each (x[i], y[i]) pair, but does eight lookups at once with
+ * AVX2 when available. The cells are only found without searching on evenly spaced axes, so that
+ * is where it is faster. Results are bit-identical to `table_lookup`. */
+void table_lookup_n(const Table* table, const float* x, const float* y, float* out, size_t n);
+/** `table_lookup_n` without the vector kernels. Mainly useful for comparison. */
+void table_lookup_n_scalar(
+    const Table* table, const float* x, const float* y, float* out, size_t n);
+
+/** The whole file at `path` as a null terminated string allocated from `a`, or NULL if it can not
+ * be opened or read. Running out of memory exits like `ra_alloc`. */
+char* ra_read_file(raAllocator* a, const char* path);
 
 #endif /* RA_COMMON_H */
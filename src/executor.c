@@ -0,0 +1,239 @@
+#include "executor.h"
+#include <assert.h>
+
+#define CHUNKS(begin, end) ((uint_least64_t)(begin) | (uint_least64_t)(end) << 32)
+#define CHUNKS_BEGIN(chunks) ((size_t)((chunks)&0xffffffff))
+#define CHUNKS_END(chunks) ((size_t)((chunks) >> 32))
+
+static bool take_chunk(raWorker* w, size_t* chunk)
+{
+    uint_least64_t chunks = atomic_load(&w->chunks);
+    do {
+        if (CHUNKS_BEGIN(chunks) >= CHUNKS_END(chunks)) {
+            return false;
+        }
+        *chunk = CHUNKS_BEGIN(chunks);
+    } while (!atomic_compare_exchange_weak(
+        &w->chunks, &chunks, CHUNKS(*chunk + 1, CHUNKS_END(chunks))));
+
+    return true;
+}
+
+static bool steal_chunk(raWorker* w, size_t* chunk)
+{
+    uint_least64_t chunks = atomic_load(&w->chunks);
+    do {
+        if (CHUNKS_BEGIN(chunks) >= CHUNKS_END(chunks)) {
+            return false;
+        }
+        *chunk = CHUNKS_END(chunks) - 1;
+    } while (!atomic_compare_exchange_weak(
+        &w->chunks, &chunks, CHUNKS(CHUNKS_BEGIN(chunks), *chunk)));
+
+    return true;
+}
+
+static void run_chunks(raExecutor* e, size_t self)
+{
+    for (;;) {
+        size_t chunk;
+        bool found = take_chunk(&e->workers[self], &chunk);
+        // Chunks are only ever taken, so once every worker is empty the step is done
+        for (size_t k = 1; !found && !e->deterministic && k < e->num_threads; k++) {
+            found = steal_chunk(&e->workers[(self + k) % e->num_threads], &chunk);
+        }
+        if (!found) {
+            return;
+        }
+
+        size_t begin = chunk * e->chunk_size;
+        size_t end = begin + e->chunk_size;
+        if (end > e->num_vehicles) {
+            end = e->num_vehicles;
+        }
+        e->job(e, chunk, begin, end);
+    }
+}
+
+static int worker_main(void* arg)
+{
+    raWorker* w = arg;
+    raExecutor* e = w->executor;
+    size_t self = (size_t)(w - e->workers);
+    unsigned long generation = 0;
+
+    for (;;) {
+        mtx_lock(&e->lock);
+        while (e->generation == generation && !e->quit) {
+            cnd_wait(&e->start, &e->lock);
+        }
+        if (e->quit) {
+            mtx_unlock(&e->lock);
+            return 0;
+        }
+        generation = e->generation;
+        mtx_unlock(&e->lock);
+
+        run_chunks(e, self);
+
+        mtx_lock(&e->lock);
+        if (--e->pending == 0) {
+            cnd_signal(&e->done);
+        }
+        mtx_unlock(&e->lock);
+    }
+}
+
+void ra_executor_init(raExecutor* e, size_t num_threads)
+{
+    assert(num_threads > 0);
+    *e = (raExecutor) {
+        .num_threads = 1,
+        .workers = ra_alloc_aligned(
+            &ra_heap_allocator, num_threads * sizeof(raWorker), RA_CACHE_LINE),
+        .generation = 0,
+        .pending = 0,
+        .quit = false,
+        .deterministic = false,
+        .chunk_hashes = NULL,
+        .chunk_hashes_capacity = 0,
+    };
+    mtx_init(&e->lock, mtx_plain);
+    cnd_init(&e->start);
+    cnd_init(&e->done);
+
+    for (size_t i = 0; i < num_threads; i++) {
+        atomic_init(&e->workers[i].chunks, CHUNKS(0, 0));
+        e->workers[i].executor = e;
+    }
+
+    // Run with the threads there are
+    while (e->num_threads < num_threads
+        && thrd_create(&e->workers[e->num_threads].thread, worker_main,
+               &e->workers[e->num_threads])
+            == thrd_success) {
+        e->num_threads++;
+    }
+}
+
+void ra_executor_free(raExecutor* e)
+{
+    mtx_lock(&e->lock);
+    e->quit = true;
+    cnd_broadcast(&e->start);
+    mtx_unlock(&e->lock);
+
+    for (size_t i = 1; i < e->num_threads; i++) {
+        thrd_join(e->workers[i].thread, NULL);
+    }
+
+    cnd_destroy(&e->done);
+    cnd_destroy(&e->start);
+    mtx_destroy(&e->lock);
+    ra_free(&ra_heap_allocator, e->workers);
+    ra_free(&ra_heap_allocator, e->chunk_hashes);
+}
+
+void ra_executor_set_deterministic(raExecutor* e, bool deterministic)
+{
+    e->deterministic = deterministic;
+}
+
+size_t ra_executor_chunk_size(const raExecutor* e, size_t num_vehicles)
+{
+    // The vehicle and the components written while stepping it
+    size_t per_vehicle = sizeof(raVehicle) + RA_VEHICLE_NUM_WHEELS * sizeof(Wheel) + sizeof(Engine)
+        + sizeof(ClutchTagged) + sizeof(Gearbox);
+    size_t size = RA_EXECUTOR_CHUNK_BYTES / per_vehicle;
+    size_t balanced = num_vehicles / (4 * e->num_threads);
+    if (!e->deterministic && balanced < size) {
+        size = balanced;
+    }
+
+    // Vehicles per cache line of the array, from the lowest set bit of the size
+    size_t stride = sizeof(raVehicle) & -sizeof(raVehicle);
+    size_t line = stride >= RA_CACHE_LINE ? 1 : RA_CACHE_LINE / stride;
+    return size < line ? line : size / line * line;
+}
+
+/** Hands out the chunks of `num_vehicles` and returns when `job` has run on all of them */
+static void run(raExecutor* e, void (*job)(raExecutor* e, size_t chunk, size_t begin, size_t end),
+    size_t num_vehicles)
+{
+    e->job = job;
+    e->num_vehicles = num_vehicles;
+    e->chunk_size = ra_executor_chunk_size(e, num_vehicles);
+
+    size_t num_chunks = (num_vehicles + e->chunk_size - 1) / e->chunk_size;
+    assert(num_chunks <= 0xffffffff);
+    for (size_t i = 0; i < e->num_threads; i++) {
+        atomic_store(&e->workers[i].chunks,
+            CHUNKS(num_chunks * i / e->num_threads, num_chunks * (i + 1) / e->num_threads));
+    }
+
+    mtx_lock(&e->lock);
+    e->generation++;
+    e->pending = e->num_threads - 1;
+    cnd_broadcast(&e->start);
+    mtx_unlock(&e->lock);
+
+    run_chunks(e, 0);
+
+    // The one barrier of the job
+    mtx_lock(&e->lock);
+    while (e->pending > 0) {
+        cnd_wait(&e->done, &e->lock);
+    }
+    mtx_unlock(&e->lock);
+}
+
+static void step_job(raExecutor* e, size_t chunk, size_t begin, size_t end)
+{
+    SUPPRESS_UNUSED(chunk);
+    for (size_t i = begin; i < end; i++) {
+        ra_vehicle_step(&e->vehicles[i], &e->inputs[i], e->dt);
+    }
+}
+
+void ra_executor_step(
+    raExecutor* e, raVehicle* vehicles, const raInputs* inputs, size_t num_vehicles, float dt)
+{
+    e->vehicles = vehicles;
+    e->inputs = inputs;
+    e->dt = dt;
+    run(e, step_job, num_vehicles);
+}
+
+static void hash_job(raExecutor* e, size_t chunk, size_t begin, size_t end)
+{
+    uint64_t hash = RA_VEHICLE_HASH_INIT;
+    for (size_t i = begin; i < end; i++) {
+        hash = ra_vehicle_hash(&e->vehicles[i], hash);
+    }
+    e->chunk_hashes[chunk] = hash;
+}
+
+uint64_t ra_executor_hash(raExecutor* e, const raVehicle* vehicles, size_t num_vehicles)
+{
+    size_t chunk_size = ra_executor_chunk_size(e, num_vehicles);
+    size_t num_chunks = (num_vehicles + chunk_size - 1) / chunk_size;
+    if (num_chunks > e->chunk_hashes_capacity) {
+        ra_free(&ra_heap_allocator, e->chunk_hashes);
+        e->chunk_hashes = ra_alloc(&ra_heap_allocator, num_chunks * sizeof(uint64_t));
+        e->chunk_hashes_capacity = num_chunks;
+    }
+
+    // Only read by the job
+    e->vehicles = (raVehicle*)vehicles;
+    run(e, hash_job, num_vehicles);
+
+    // In the order of the chunks, whichever thread hashed them
+    uint64_t hash = RA_VEHICLE_HASH_INIT;
+    for (size_t i = 0; i < num_chunks; i++) {
+        for (int b = 0; b < 8; b++) {
+            hash ^= (e->chunk_hashes[i] >> (8 * b)) & 0xff;
+            hash *= 0x100000001b3u;
+        }
+    }
+    return hash;
+}
@@ -0,0 +1,87 @@
+#ifndef RA_EXECUTOR_H
+#define RA_EXECUTOR_H
+#include "alloc.h"
+#include "vehicle.h"
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <threads.h>
+
+/** Vehicle state a chunk is sized after, half of a common L1 data cache */
+#define RA_EXECUTOR_CHUNK_BYTES (16 * 1024)
+
+typedef struct raExecutor raExecutor;
+
+/** A thread and the chunks it has left of the current step, on cache lines of its own */
+typedef struct {
+    /** The first chunk left in the low 32 bits and one past the last in the high 32 bits. The
+     * owner takes chunks from the front, and other workers steal them from the back. */
+    alignas(RA_CACHE_LINE) atomic_uint_least64_t chunks;
+    raExecutor* executor;
+    thrd_t thread;
+} raWorker;
+
+/** A pool of threads stepping arrays of vehicles. The thread calling `ra_executor_step` works too,
+ * so a pool of one thread starts no threads. */
+struct raExecutor {
+    size_t num_threads;
+    /** One per thread, the first one is the calling thread */
+    raWorker* workers;
+
+    mtx_t lock;
+    /** Signaled when `generation` changes or `quit` is set */
+    cnd_t start;
+    /** Signaled when `pending` reaches zero */
+    cnd_t done;
+    /** Counts the steps, so the threads know when a new one starts */
+    unsigned long generation;
+    /** Started threads that have not finished the current step */
+    size_t pending;
+    bool quit;
+    /** Set with `ra_executor_set_deterministic` */
+    bool deterministic;
+
+    /** The current job, run on the vehicles from `begin` to `end` of every chunk */
+    void (*job)(raExecutor* e, size_t chunk, size_t begin, size_t end);
+    raVehicle* vehicles;
+    const raInputs* inputs;
+    size_t num_vehicles;
+    size_t chunk_size;
+    float dt;
+    /** One per chunk for `ra_executor_hash`, reused between calls */
+    uint64_t* chunk_hashes;
+    size_t chunk_hashes_capacity;
+};
+
+/** Starts `num_threads - 1` threads, which sleep between steps. Starts fewer if the system can not
+ * make more. */
+void ra_executor_init(raExecutor* e, size_t num_threads);
+void ra_executor_free(raExecutor* e);
+/** In deterministic mode every thread steps a fixed range of chunks and steals nothing, and the
+ * chunks only depend on the number of vehicles. Which thread steps a vehicle then only depends on
+ * the number of vehicles and threads, and reductions over the chunks like `ra_executor_hash` give
+ * the same result for any number of threads. Stepping gives bitwise the same vehicles in either
+ * mode. Off by default. */
+void ra_executor_set_deterministic(raExecutor* e, bool deterministic);
+/** Vehicles per chunk when stepping `num_vehicles`. A chunk holds at most
+ * `RA_EXECUTOR_CHUNK_BYTES` of vehicle state and ends on a cache line of a vehicle array aligned to
+ * `RA_CACHE_LINE`. Unless deterministic, the chunks are also small enough to leave a few per thread
+ * to steal. */
+size_t ra_executor_chunk_size(const raExecutor* e, size_t num_vehicles);
+/** Steps every vehicle once with `ra_vehicle_step`, `inputs` holding one element per vehicle.
+ * The vehicles are split into chunks handed out to the threads, which steal chunks from each other
+ * when they run out, since the cost of a vehicle varies with clutch slip, ABS and gear changes.
+ * Returns when every vehicle has been stepped. A vehicle only touches its own state, so the
+ * result is the same as stepping them in order on one thread. `vehicles` should be aligned to
+ * `RA_CACHE_LINE`, so no two threads write to the same cache line of it, and cloned with
+ * `ra_vehicle_clone_aligned`, so neither do they in the state of the vehicles. */
+void ra_executor_step(
+    raExecutor* e, raVehicle* vehicles, const raInputs* inputs, size_t num_vehicles, float dt);
+/** `ra_vehicle_hash` of every vehicle in parallel. Each chunk is hashed from
+ * `RA_VEHICLE_HASH_INIT`, and the hashes of the chunks are folded in order on the calling thread.
+ * The result depends on the chunks, so it only compares between thread counts in deterministic
+ * mode. */
+uint64_t ra_executor_hash(raExecutor* e, const raVehicle* vehicles, size_t num_vehicles);
+
+#endif /* RA_EXECUTOR_H */
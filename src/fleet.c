@@ -0,0 +1,354 @@
+#include "fleet.h"
+#include "tiremodel.h"
+
+#define NUM_WHEELS RA_VEHICLE_NUM_WHEELS
+
+static void* fleet_alloc(size_t n, size_t size)
+{
+    return ra_alloc(&ra_heap_allocator, n * size);
+}
+
+/** The differential behind the gearbox, see `ra_vehicle_init` */
+static const Differential* vehicle_differential(const raVehicle* v)
+{
+    raTaggedComponent* c = v->powertrain.subsystems[raVehicleSubsystemEngine];
+    for (int k = 0; k < 3; k++) {
+        c = c->tty.normal.next;
+    }
+    return (const Differential*)c->ty;
+}
+
+void ra_fleet_init(raFleet* f, const raVehicle* v, size_t num_vehicles)
+{
+    size_t n = num_vehicles;
+    size_t num_wheels = n * NUM_WHEELS;
+
+    *f = (raFleet) {
+        .num_vehicles = n,
+        .params = v->params,
+        .engine = engine_clone(&ra_heap_allocator, v->engine, true),
+        .clutch = *v->clutch->c,
+        .clutch_normal_force = v->clutch_normal_force,
+        .gearbox = gearbox_clone(&ra_heap_allocator, v->gearbox, true),
+        .differential = *vehicle_differential(v),
+        .engine_velocity = fleet_alloc(n, sizeof(AngularVelocity)),
+        .engine_cursors = fleet_alloc(n, sizeof(TableCursor)),
+        .rev_limiters = fleet_alloc(n, sizeof(RevLimiterHard)),
+        .clutch_normal_forces = fleet_alloc(n, sizeof(float)),
+        .clutch_locked = fleet_alloc(n, sizeof(bool)),
+        .gears = fleet_alloc(n, sizeof(int)),
+        .gearbox_velocity = fleet_alloc(n, sizeof(AngularVelocity)),
+        .lanes = {
+            .hub_velocity_x = fleet_alloc(num_wheels, sizeof(float)),
+            .hub_velocity_y = fleet_alloc(num_wheels, sizeof(float)),
+            .angle = fleet_alloc(num_wheels, sizeof(float)),
+            .angular_velocity = fleet_alloc(num_wheels, sizeof(float)),
+            .input_torque = fleet_alloc(num_wheels, sizeof(float)),
+            .reaction_torque = fleet_alloc(num_wheels, sizeof(float)),
+            .external_torque = fleet_alloc(num_wheels, sizeof(float)),
+        },
+        .velocity_x = fleet_alloc(n, sizeof(float)),
+        .velocity_y = fleet_alloc(n, sizeof(float)),
+        .position_x = fleet_alloc(n, sizeof(float)),
+        .position_y = fleet_alloc(n, sizeof(float)),
+        .yaw_velocity = fleet_alloc(n, sizeof(float)),
+        .rotation = fleet_alloc(n, sizeof(float)),
+        .engine_torque = fleet_alloc(n, sizeof(float)),
+        .force_x = fleet_alloc(n, sizeof(float)),
+        .force_y = fleet_alloc(n, sizeof(float)),
+        .wheel_forces = fleet_alloc(num_wheels, sizeof(Vector2f)),
+        .master_pressure = fleet_alloc(n, sizeof(float)),
+        .drive_torque = fleet_alloc(num_wheels, sizeof(float)),
+        .drive_inertia = fleet_alloc(num_wheels, sizeof(float)),
+    };
+
+    for (size_t l = 0; l < NUM_WHEELS; l++) {
+        f->wheels[l] = wheel_clone(&ra_heap_allocator, v->wheels[l]);
+        f->effective_radius[l] = v->wheels[l]->effective_radius;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        f->engine_velocity[i] = v->engine->angular_velocity;
+        f->engine_cursors[i] = v->engine->torque_cursor;
+        f->rev_limiters[i] = v->rev_limiter;
+        f->clutch_normal_forces[i] = v->clutch->curr_normal_force;
+        f->clutch_locked[i] = v->clutch->c->is_locked;
+        f->gears[i] = v->gearbox->curr_gear;
+        f->gearbox_velocity[i] = v->gearbox->input_angular_velocity;
+
+        for (size_t l = 0; l < NUM_WHEELS; l++) {
+            const Wheel* w = v->wheels[l];
+            size_t k = i * NUM_WHEELS + l;
+            f->lanes.hub_velocity_x[k] = w->hub_velocity.x;
+            f->lanes.hub_velocity_y[k] = w->hub_velocity.y;
+            f->lanes.angle[k] = w->angle;
+            f->lanes.angular_velocity[k] = w->angular_velocity;
+            f->lanes.input_torque[k] = w->input_torque;
+            f->lanes.reaction_torque[k] = w->reaction_torque;
+            f->lanes.external_torque[k] = w->external_torque;
+            f->wheel_forces[k] = v->wheel_forces[l];
+            f->drive_torque[k] = 0.0f;
+            f->drive_inertia[k] = 0.0f;
+        }
+
+        f->velocity_x[i] = v->velocity.x;
+        f->velocity_y[i] = v->velocity.y;
+        f->position_x[i] = v->position.x;
+        f->position_y[i] = v->position.y;
+        f->yaw_velocity[i] = v->yaw_velocity;
+        f->rotation[i] = v->rotation;
+        f->engine_torque[i] = v->engine_torque;
+        f->force_x[i] = v->force.x;
+        f->force_y[i] = v->force.y;
+    }
+}
+
+void ra_fleet_free(raFleet* f)
+{
+    engine_free(f->engine);
+    gearbox_free(f->gearbox);
+    for (size_t l = 0; l < NUM_WHEELS; l++) {
+        ra_free(&ra_heap_allocator, f->wheels[l]);
+    }
+
+    const WheelLanes* w = &f->lanes;
+    void* arrays[] = { f->engine_velocity, f->engine_cursors, f->rev_limiters,
+        f->clutch_normal_forces, f->clutch_locked, f->gears, f->gearbox_velocity,
+        w->hub_velocity_x, w->hub_velocity_y, w->angle, w->angular_velocity, w->input_torque,
+        w->reaction_torque, w->external_torque, f->velocity_x, f->velocity_y, f->position_x,
+        f->position_y, f->yaw_velocity, f->rotation, f->engine_torque, f->force_x, f->force_y,
+        f->wheel_forces, f->master_pressure, f->drive_torque, f->drive_inertia };
+    for (size_t k = 0; k < sizeof arrays / sizeof arrays[0]; k++) {
+        ra_free(&ra_heap_allocator, arrays[k]);
+    }
+}
+
+/** Loads the gearbox of vehicle `i` into `f->gearbox` */
+static Gearbox* load_gearbox(raFleet* f, size_t i)
+{
+    f->gearbox->curr_gear = f->gears[i];
+    f->gearbox->input_angular_velocity = f->gearbox_velocity[i];
+    return f->gearbox;
+}
+
+void ra_fleet_upshift(raFleet* f, size_t vehicle)
+{
+    gearbox_upshift(load_gearbox(f, vehicle));
+    f->gears[vehicle] = f->gearbox->curr_gear;
+}
+
+void ra_fleet_downshift(raFleet* f, size_t vehicle)
+{
+    gearbox_downshift(load_gearbox(f, vehicle));
+    f->gears[vehicle] = f->gearbox->curr_gear;
+}
+
+/** Direction changes, steering, engine and clutch */
+static void step_drivers(raFleet* f, const raInputs* inputs, float dt)
+{
+    const raVehicleParams* p = &f->params;
+    Engine* engine = f->engine;
+    Wheel* fl = f->wheels[raVehicleWheelFl];
+    Wheel* fr = f->wheels[raVehicleWheelFr];
+    for (size_t i = 0; i < f->num_vehicles; i++) {
+        const raInputs* in = &inputs[i];
+        size_t w = i * NUM_WHEELS;
+        if (f->gears[i] == 1) {
+            for (int l = 0; l < NUM_WHEELS; ++l) {
+                wheel_lanes_try_change_direction(
+                    &f->lanes, w + l, f->wheels[l], WheelDirectionForward);
+            }
+        } else if (f->gears[i] == -1) {
+            for (int l = 0; l < NUM_WHEELS; ++l) {
+                wheel_lanes_try_change_direction(
+                    &f->lanes, w + l, f->wheels[l], WheelDirectionReverse);
+            }
+        }
+
+        set_ackerman_angle(in->steering * p->steering_ratio, p->body.wheelbase, fl, fr);
+        f->lanes.angle[w + raVehicleWheelFl] = fl->angle;
+        f->lanes.angle[w + raVehicleWheelFr] = fr->angle;
+
+        engine->angular_velocity = f->engine_velocity[i];
+        engine->torque_cursor = f->engine_cursors[i];
+        float throttle = rev_limiter_hard(&f->rev_limiters[i], engine, in->throttle);
+        float pre_engine_torque = engine_torque(engine, throttle);
+        f->engine_torque[i] = idle_engine_torque(
+            p->idle_velocity, engine, pre_engine_torque, in->clutch == 1.0, dt);
+        f->engine_cursors[i] = engine->torque_cursor;
+
+        f->clutch_normal_forces[i] = f->clutch_normal_force * (1.0 - in->clutch);
+        f->master_pressure[i] = p->master_cylinder.max_pressure * in->brake;
+    }
+}
+
+/** ABS and brake torque for every wheel */
+static void step_brakes(raFleet* f)
+{
+    const raVehicleParams* p = &f->params;
+    const WheelLanes* lanes = &f->lanes;
+    for (size_t i = 0; i < f->num_vehicles; i++) {
+        for (int l = 0; l < NUM_WHEELS; l++) {
+            size_t k = i * NUM_WHEELS + l;
+            float vel = lanes->hub_velocity_x[k];
+            float angular_velocity = lanes->angular_velocity[k];
+            Vector2f hub = (Vector2f) { .x = vel, .y = lanes->hub_velocity_y[k] };
+            float slip = slip_ratio(hub, angular_velocity, f->effective_radius[l]);
+            float brake_pressure = abs_pressure(&p->abs[l], f->master_pressure[i], vel, slip);
+            lanes->external_torque[k] = brake_torque(
+                &p->brake_disc, &p->calipers[l], brake_pressure, angular_velocity, vel);
+        }
+    }
+}
+
+/** The torque the clutch, gearbox and differential pass on to the rear wheels, and the inertia the
+ * wheels see through them. A slipping clutch gives the rest of the torque back to the engine. */
+static void step_drivelines(raFleet* f, float dt)
+{
+    const WheelLanes* lanes = &f->lanes;
+    Engine* engine = f->engine;
+    Differential* diff = &f->differential;
+    for (size_t i = 0; i < f->num_vehicles; i++) {
+        size_t rl = i * NUM_WHEELS + raVehicleWheelRl;
+        size_t rr = i * NUM_WHEELS + raVehicleWheelRr;
+        Gearbox* gb = load_gearbox(f, i);
+
+        float out_vel = differential_velocity(
+            diff, lanes->angular_velocity[rl], lanes->angular_velocity[rr]);
+        float right_vel = gearbox_angular_velocity_in(gb, out_vel);
+        f->gearbox_velocity[i] = gb->input_angular_velocity;
+
+        Clutch clutch = f->clutch;
+        float torque_left, torque_right;
+        clutch_torque_out(&clutch, f->engine_torque[i], f->clutch_normal_forces[i],
+            f->engine_velocity[i], right_vel, &torque_left, &torque_right);
+        f->clutch_locked[i] = clutch.is_locked;
+
+        float react_left = lanes->reaction_torque[rl] + lanes->external_torque[rl];
+        float react_right = lanes->reaction_torque[rr] + lanes->external_torque[rr];
+        differential_torque(diff, gearbox_torque_out(gb, torque_right), react_left, react_right,
+            &f->drive_torque[rl], &f->drive_torque[rr]);
+
+        // A slipping clutch separates the engine from the rest of the driveline
+        float engine_inertia = clutch.is_locked ? engine->inertia : 0.0f;
+        float inertia = gearbox_inertia(gb) + engine_inertia + diff->inertia;
+        if (diff->ty == DiffTypeLocked) {
+            f->drive_inertia[rl] = inertia + f->wheels[raVehicleWheelRr]->inertia;
+            f->drive_inertia[rr] = inertia + f->wheels[raVehicleWheelRl]->inertia;
+        } else {
+            f->drive_inertia[rl] = inertia;
+            f->drive_inertia[rr] = inertia;
+        }
+
+        if (!clutch.is_locked) {
+            float a = torque_left / engine->inertia;
+            engine_set_angular_velocity(engine, f->engine_velocity[i] + integrate(a, dt));
+            f->engine_velocity[i] = engine->angular_velocity;
+        }
+    }
+}
+
+/** Integrates the velocity of every wheel */
+static void step_wheels(raFleet* f, float dt)
+{
+    for (size_t i = 0; i < f->num_vehicles; i++) {
+        Vector2f velocity = { .x = f->velocity_x[i], .y = f->velocity_y[i] };
+        for (int l = 0; l < NUM_WHEELS; l++) {
+            size_t k = i * NUM_WHEELS + l;
+            wheel_lanes_update(&f->lanes, k, f->wheels[l], velocity, f->yaw_velocity[i],
+                f->drive_inertia[k], f->drive_torque[k], dt);
+        }
+    }
+}
+
+static void step_tires(raFleet* f)
+{
+    const raVehicleParams* p = &f->params;
+    const WheelLanes* lanes = &f->lanes;
+    for (size_t i = 0; i < f->num_vehicles; i++) {
+        float fz = p->mass * p->gravity * 0.5;
+        float fzf_lift = body_lift_front(&p->body, p->air_density, f->velocity_x[i]);
+        float fzr_lift = body_lift_rear(&p->body, p->air_density, f->velocity_x[i]);
+
+        float fz_front = (fz + fzf_lift) * 0.5;
+        float fz_rear = (fz + fzr_lift) * 0.5;
+        float fzs[NUM_WHEELS] = { fz_front, fz_front, fz_rear, fz_rear };
+
+        size_t w = i * NUM_WHEELS;
+        WheelQuad q = {
+            .hub_velocity_x = &lanes->hub_velocity_x[w],
+            .hub_velocity_y = &lanes->hub_velocity_y[w],
+            .angular_velocity = &lanes->angular_velocity[w],
+            .effective_radius = f->effective_radius,
+            .angle = &lanes->angle[w],
+        };
+        wheel_quad_force(&q, p->tire_model, fzs, p->friction, &f->wheel_forces[w],
+            &lanes->reaction_torque[w]);
+    }
+}
+
+static void step_bodies(raFleet* f, float dt)
+{
+    const raVehicleParams* p = &f->params;
+    for (size_t i = 0; i < f->num_vehicles; i++) {
+        Vector2f* forces = &f->wheel_forces[i * NUM_WHEELS];
+        Vector2f sum_force = body_air_resistance(&p->body, p->air_density, f->velocity_x[i]);
+        for (int l = 0; l < NUM_WHEELS; l++) {
+            sum_force = VECTOR2F_PLUS(sum_force, forces[l]);
+        }
+        f->force_x[i] = sum_force.x;
+        f->force_y[i] = sum_force.y;
+
+        Vector2f velocity = { .x = f->velocity_x[i], .y = f->velocity_y[i] };
+        velocity.x += integrate(sum_force.x / p->mass, dt);
+        velocity.y += integrate(sum_force.y / p->mass, dt);
+
+        float hub_velocity_x = f->lanes.hub_velocity_x[i * NUM_WHEELS + raVehicleWheelFl];
+        if (signum(hub_velocity_x) != signum(velocity.x)) {
+            velocity.x = 0.0;
+        }
+        f->velocity_x[i] = velocity.x;
+        f->velocity_y[i] = velocity.y;
+
+        Vector2f vel_world = vector2f_rotate(velocity, f->rotation[i]);
+        f->position_x[i] += vel_world.x * dt;
+        f->position_y[i] += vel_world.y * dt;
+
+        float zz_torque = yaw_torque(f->wheels, forces, NUM_WHEELS);
+        f->yaw_velocity[i] += zz_torque / p->i_zz * dt;
+        f->rotation[i] += f->yaw_velocity[i] * dt;
+    }
+}
+
+/** What `ra_powertrain_schedule_update_angular_velocity` does to the engine and gearbox. The engine
+ * only follows the wheels through a locked clutch. */
+static void step_engines(raFleet* f)
+{
+    const WheelLanes* lanes = &f->lanes;
+    Engine* engine = f->engine;
+    for (size_t i = 0; i < f->num_vehicles; i++) {
+        float velocity = f->engine_velocity[i];
+        if (f->clutch_locked[i]) {
+            size_t w = i * NUM_WHEELS;
+            float out_vel = differential_velocity(&f->differential,
+                lanes->angular_velocity[w + raVehicleWheelRl],
+                lanes->angular_velocity[w + raVehicleWheelRr]);
+            velocity = gearbox_angular_velocity_in(load_gearbox(f, i), out_vel);
+            f->gearbox_velocity[i] = f->gearbox->input_angular_velocity;
+        }
+
+        engine_set_angular_velocity(engine, velocity);
+        f->engine_velocity[i] = engine->angular_velocity;
+    }
+}
+
+void ra_fleet_step(raFleet* f, const raInputs* inputs, float dt)
+{
+    step_drivers(f, inputs, dt);
+    step_brakes(f);
+    step_drivelines(f, dt);
+    step_wheels(f, dt);
+    step_tires(f);
+    step_bodies(f, dt);
+    step_engines(f);
+}
@@ -0,0 +1,72 @@
+#ifndef RA_FLEET_H
+#define RA_FLEET_H
+#include "vehicle.h"
+#include "wheel.h"
+
+/** Copies of one vehicle stepped in lockstep. The state of every vehicle is kept in arrays with
+ * one element per vehicle, or one per wheel, and each stage of the step runs over every vehicle
+ * before the next one starts. The fleet is specialized to the powertrain `ra_vehicle_init` builds,
+ * so the driveline is stepped without going through a schedule. Every vehicle ends up exactly
+ * where stepping it alone with `ra_vehicle_step` would take it. */
+typedef struct {
+    size_t num_vehicles;
+    raVehicleParams params;
+
+    /** The parts every vehicle is a copy of. Only their constants are used, the state of a vehicle
+     * is loaded into them where a function of the part needs it. The engine and gearbox share
+     * their torque map and ratios with the vehicle the fleet was made from. */
+    Engine* engine;
+    Clutch clutch;
+    float clutch_normal_force;
+    Gearbox* gearbox;
+    Differential differential;
+    /** In the order of `raVehicle`. The front wheels also hold the angles while steering. */
+    Wheel* wheels[RA_VEHICLE_NUM_WHEELS];
+    float effective_radius[RA_VEHICLE_NUM_WHEELS];
+
+    /** Per vehicle */
+    AngularVelocity* engine_velocity;
+    TableCursor* engine_cursors;
+    RevLimiterHard* rev_limiters;
+    float* clutch_normal_forces;
+    bool* clutch_locked;
+    int* gears;
+    AngularVelocity* gearbox_velocity;
+
+    /** `RA_VEHICLE_NUM_WHEELS` per vehicle, in the order of `raVehicle` */
+    WheelLanes lanes;
+
+    /** Per vehicle, in iso8855 coordinates */
+    float* velocity_x;
+    float* velocity_y;
+    float* position_x;
+    float* position_y;
+    float* yaw_velocity;
+    float* rotation;
+
+    /** From the last step, like the results in `raVehicle` */
+    float* engine_torque;
+    float* force_x;
+    float* force_y;
+    /** `RA_VEHICLE_NUM_WHEELS` per vehicle */
+    Vector2f* wheel_forces;
+
+    /** Scratch space for the step. The torque and inertia of the driveline are per wheel, and
+     * stay 0.0 for the front wheels. */
+    float* master_pressure;
+    float* drive_torque;
+    float* drive_inertia;
+} raFleet;
+
+/** Makes `num_vehicles` copies of `v` in its current state. `v` must have been made by
+ * `ra_vehicle_init` or `ra_vehicle_clone`, and must outlive the fleet. */
+void ra_fleet_init(raFleet* f, const raVehicle* v, size_t num_vehicles);
+void ra_fleet_free(raFleet* f);
+/** Same as `ra_vehicle_step` on every vehicle, with `inputs` holding one element per vehicle */
+void ra_fleet_step(raFleet* f, const raInputs* inputs, float dt);
+/** `gearbox_upshift` on the gearbox of one vehicle */
+void ra_fleet_upshift(raFleet* f, size_t vehicle);
+/** `gearbox_downshift` on the gearbox of one vehicle */
+void ra_fleet_downshift(raFleet* f, size_t vehicle);
+
+#endif /* RA_FLEET_H */
@@ -3,6 +3,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 static float normal_ext_torque(raTaggedComponent* t)
 {
@@ -36,26 +37,161 @@ float rev_limiter_hard(RevLimiterHard* r, Engine* e, float throttle_pos)
 
 Engine* engine_new(float inertia, Table torque_map)
 {
-    Engine* engine = malloc(sizeof *engine);
-    if (engine == NULL) {
-        exit(EXIT_FAILURE);
-    }
+    return engine_new_in(&ra_heap_allocator, inertia, torque_map);
+}
 
+Engine* engine_new_in(raAllocator* a, float inertia, Table torque_map)
+{
+    Engine* engine = ra_alloc(a, sizeof *engine);
+    engine->allocator = a;
     engine->torque_map = torque_map;
+    engine->curves = (EngineCurves) { .inv_dx = NULL };
+    engine->torque_cursor = table_cursor_new();
     engine->angular_velocity = 0.0f;
     engine->inertia = inertia;
+    engine_compile(engine);
     return engine;
 }
 
+static float inv_span(float below, float above)
+{
+    return above > below ? 1.0f / (above - below) : 0.0f;
+}
+
+/** Number of floats in the one allocation holding all of `EngineCurves` */
+static size_t curves_len(const Table* map)
+{
+    size_t nx = map->x_capacity;
+    size_t ny = map->y_capacity;
+    return (nx - 1) + (ny - 1) + nx * (ny - 1) + 2 * ny + 2 * (ny - 1);
+}
+
+void engine_compile(Engine* engine)
+{
+    const Table* map = &engine->torque_map;
+    size_t nx = map->x_capacity;
+    size_t ny = map->y_capacity;
+
+    if (engine->curves.owned) {
+        ra_free(engine->allocator, engine->curves.inv_dx);
+    }
+    size_t len = curves_len(map);
+    float* block = ra_alloc(engine->allocator, len * sizeof *block);
+
+    EngineCurves* c = &engine->curves;
+    c->owned = true;
+    c->inv_dx = block;
+    c->inv_dy = c->inv_dx + (nx - 1);
+    c->slope = c->inv_dy + (ny - 1);
+    c->min_torque = c->slope + nx * (ny - 1);
+    c->min_slope = c->min_torque + ny;
+    c->max_torque = c->min_slope + (ny - 1);
+    c->max_slope = c->max_torque + ny;
+
+    for (size_t i = 0; i < nx - 1; i++) {
+        c->inv_dx[i] = inv_span(map->x[i], map->x[i + 1]);
+    }
+
+    for (size_t j = 0; j < ny - 1; j++) {
+        c->inv_dy[j] = inv_span(map->y[j], map->y[j + 1]);
+    }
+
+    for (size_t i = 0; i < nx; i++) {
+        for (size_t j = 0; j < ny - 1; j++) {
+            float dz = table_get(map, i, j + 1) - table_get(map, i, j);
+            c->slope[i * (ny - 1) + j] = dz * c->inv_dy[j];
+        }
+    }
+
+    // Blending whole rows the same way engine_torque blends the two rows it interpolates
+    // between, gives the exact same result when the throttle is on a breakpoint.
+    float throttles[2] = { 0.0f, 1.0f };
+    float* torques[2] = { c->min_torque, c->max_torque };
+    float* slopes[2] = { c->min_slope, c->max_slope };
+    TableCursor cursor = table_cursor_new();
+
+    for (size_t k = 0; k < 2; k++) {
+        size_t i = table_find_x(map, &cursor, throttles[k]);
+        float f = (throttles[k] - map->x[i]) * c->inv_dx[i];
+        for (size_t j = 0; j < ny; j++) {
+            torques[k][j] = table_get(map, i, j) * (1.0f - f) + table_get(map, i + 1, j) * f;
+        }
+
+        for (size_t j = 0; j < ny - 1; j++) {
+            slopes[k][j] = c->slope[i * (ny - 1) + j] * (1.0f - f)
+                + c->slope[(i + 1) * (ny - 1) + j] * f;
+        }
+    }
+}
+
+Engine* engine_clone(raAllocator* a, const Engine* engine, bool share)
+{
+    Engine* clone = ra_alloc(a, sizeof *clone);
+    *clone = *engine;
+    clone->allocator = a;
+    if (share) {
+        clone->torque_map = table_borrow(&engine->torque_map);
+        clone->curves.owned = false;
+        return clone;
+    }
+
+    clone->torque_map = table_clone_in(a, &engine->torque_map);
+    size_t len = curves_len(&engine->torque_map);
+    const EngineCurves* src = &engine->curves;
+    float* block = ra_alloc(a, len * sizeof *block);
+    memcpy(block, src->inv_dx, len * sizeof *block);
+    EngineCurves* c = &clone->curves;
+    c->owned = true;
+    c->inv_dx = block;
+    c->inv_dy = block + (src->inv_dy - src->inv_dx);
+    c->slope = block + (src->slope - src->inv_dx);
+    c->min_torque = block + (src->min_torque - src->inv_dx);
+    c->min_slope = block + (src->min_slope - src->inv_dx);
+    c->max_torque = block + (src->max_torque - src->inv_dx);
+    c->max_slope = block + (src->max_slope - src->inv_dx);
+    return clone;
+}
+
 void engine_free(Engine* engine)
 {
     table_free(&engine->torque_map);
-    free(engine);
+    if (engine->curves.owned) {
+        ra_free(engine->allocator, engine->curves.inv_dx);
+    }
+    ra_free(engine->allocator, engine);
 }
 
 float engine_torque(Engine* engine, float throttle_pos)
 {
-    return table_lookup(&engine->torque_map, throttle_pos, engine->angular_velocity);
+    const Table* map = &engine->torque_map;
+    const EngineCurves* c = &engine->curves;
+    size_t ny = map->y_capacity;
+
+    size_t i = table_find_x(map, &engine->torque_cursor, throttle_pos);
+    size_t j = table_find_y(map, &engine->torque_cursor, engine->angular_velocity);
+
+    float dy = engine->angular_velocity - map->y[j];
+    float lower = map->z[i * ny + j] + dy * c->slope[i * (ny - 1) + j];
+    float upper = map->z[(i + 1) * ny + j] + dy * c->slope[(i + 1) * (ny - 1) + j];
+
+    float f = (throttle_pos - map->x[i]) * c->inv_dx[i];
+    return lower * (1.0f - f) + upper * f;
+}
+
+static float engine_curve(Engine* engine, const float* torque, const float* slope)
+{
+    size_t j = table_find_y(&engine->torque_map, &engine->torque_cursor, engine->angular_velocity);
+    return torque[j] + (engine->angular_velocity - engine->torque_map.y[j]) * slope[j];
+}
+
+float engine_min_torque(Engine* engine)
+{
+    return engine_curve(engine, engine->curves.min_torque, engine->curves.min_slope);
+}
+
+float engine_max_torque(Engine* engine)
+{
+    return engine_curve(engine, engine->curves.max_torque, engine->curves.max_slope);
 }
 
 float engine_demanded_torque(
@@ -64,8 +200,8 @@ float engine_demanded_torque(
     float vel_diff = desired_velocity - engine->angular_velocity;
     float torque = (vel_diff / dt) * (engine->inertia + external_inertia);
 
-    float min_torque = engine_torque(engine, 0.0);
-    float max_torque = engine_torque(engine, 1.0);
+    float min_torque = engine_min_torque(engine);
+    float max_torque = engine_max_torque(engine);
 
     return fmaxf(min_torque, fminf(torque, max_torque));
 }
@@ -109,11 +245,94 @@ static float engine_update_angular_velocity(raTaggedComponent* t)
     return e->angular_velocity;
 }
 
+static bool engine_flat_needs_children(raTaggedComponent* t, raQuery q)
+{
+    SUPPRESS_UNUSED(t);
+    return q != raQueryAngularVelocity;
+}
+
+static float engine_flat_query(
+    raPowertrainSchedule* s, size_t node, raQuery q, const float children[2])
+{
+    Engine* e = (Engine*)s->nodes[node].c->ty;
+    switch (q) {
+    case raQueryUpdateAngularVelocity:
+        engine_set_angular_velocity(e, children[0]);
+        return e->angular_velocity;
+    case raQueryExternalTorque:
+        return children[0];
+    case raQueryInertiaNext:
+        return e->inertia + children[0];
+    default:
+        return e->angular_velocity;
+    }
+}
+
+static float engine_flat_inertia_prev(raPowertrainSchedule* s, size_t node, float up, int from)
+{
+    SUPPRESS_UNUSED(up);
+    SUPPRESS_UNUSED(from);
+    return ((Engine*)s->nodes[node].c->ty)->inertia;
+}
+
+static void engine_flat_send_torque(
+    raPowertrainSchedule* s, size_t node, raVelocities v, float torque, float dt)
+{
+    SUPPRESS_UNUSED(v);
+    SUPPRESS_UNUSED(dt);
+    ra_powertrain_schedule_pass_torque(s, node, 0, torque);
+}
+
+static void engine_flat_receive_torque(
+    raPowertrainSchedule* s, size_t node, float torque, float dt)
+{
+    float a = torque / ra_powertrain_schedule_inertia_prev(s, node, -1);
+    Engine* e = (Engine*)s->nodes[node].c->ty;
+    engine_set_angular_velocity(e, e->angular_velocity + integrate(a, dt));
+}
+
+static const raFlatOps engine_flat_ops = {
+    .needs_children = engine_flat_needs_children,
+    .query = engine_flat_query,
+    .inertia_prev = engine_flat_inertia_prev,
+    .send_torque = engine_flat_send_torque,
+    .receive_torque = engine_flat_receive_torque,
+    .inertia_key = NULL,
+};
+
+static void engine_free_in(raAllocator* a, void* engine)
+{
+    // The engine knows its own allocator
+    SUPPRESS_UNUSED(a);
+    engine_free((Engine*)engine);
+}
+
+static void* engine_clone_ty(raAllocator* a, const void* engine, bool share)
+{
+    return engine_clone(a, (const Engine*)engine, share);
+}
+
+static const raComponentOps engine_ops = {
+    .inertia_fn = engine_inertia,
+    .angular_velocity_fn = engine_angular_vel,
+    .send_torque_fn = engine_send_torque,
+    .receive_torque = engine_receive_torque,
+    .update_angular_velocity = engine_update_angular_velocity,
+    .external_torque = normal_ext_torque,
+    .free_fn = NULL,
+    .free_in_fn = engine_free_in,
+    .clone_fn = engine_clone_ty,
+    .flat_ops = &engine_flat_ops,
+};
+
 raTaggedComponent* ra_tag_engine(Engine* engine)
 {
-    return ra_tagged_new(engine, engine_inertia, engine_angular_vel, engine_send_torque,
-        engine_receive_torque, engine_update_angular_velocity, normal_ext_torque,
-        (void (*)(void*))engine_free);
+    return ra_tag_engine_in(&ra_heap_allocator, engine);
+}
+
+raTaggedComponent* ra_tag_engine_in(raAllocator* a, Engine* engine)
+{
+    return ra_tagged_new_with_ops(a, engine, raTyNormal, &engine_ops);
 }
 
 float idle_engine_torque(
@@ -134,10 +353,12 @@ float idle_engine_torque(
 
 Differential* differential_new(float ratio, float inertia, DiffType ty)
 {
-    Differential* diff = malloc(sizeof *diff);
-    if (diff == NULL) {
-        exit(EXIT_FAILURE);
-    }
+    return differential_new_in(&ra_heap_allocator, ratio, inertia, ty);
+}
+
+Differential* differential_new_in(raAllocator* a, float ratio, float inertia, DiffType ty)
+{
+    Differential* diff = ra_alloc(a, sizeof *diff);
     diff->ratio = ratio;
     diff->inertia = inertia;
     diff->ty = ty;
@@ -242,19 +463,118 @@ static float diff_ext_torque(raTaggedComponent* t)
     return ra_tagged_external_torque(s.next_left) + ra_tagged_external_torque(s.next_right);
 }
 
-raTaggedComponent* ra_tag_differential(Differential* diff)
+static bool flat_needs_children(raTaggedComponent* t, raQuery q)
 {
-    return ra_tagged_split_new(diff, diff_inertia, diff_angular_vel, diff_send_torque, NULL,
-        diff_update_angular_velocity, diff_ext_torque, free);
+    SUPPRESS_UNUSED(t);
+    SUPPRESS_UNUSED(q);
+    return true;
 }
 
-Gearbox* gearbox_new(VecFloat ratios, VecFloat inertias)
+static float diff_flat_query(
+    raPowertrainSchedule* s, size_t node, raQuery q, const float children[2])
 {
-    Gearbox* gb = malloc(sizeof *gb);
-    if (gb == NULL) {
+    Differential* diff = (Differential*)s->nodes[node].c->ty;
+    switch (q) {
+    case raQueryExternalTorque:
+        return children[0] + children[1];
+    case raQueryInertiaNext:
+        return diff->inertia + children[0] + children[1];
+    default:
+        return differential_velocity(diff, children[0], children[1]);
+    }
+}
+
+static float diff_flat_inertia_prev(raPowertrainSchedule* s, size_t node, float up, int from)
+{
+    Differential* diff = (Differential*)s->nodes[node].c->ty;
+    const size_t* children = s->nodes[node].children;
+    float inertia_prev = up + diff->inertia;
+    if (diff->ty != DiffTypeLocked) {
+        return inertia_prev;
+    } else if (from == 0) {
+        return inertia_prev + ra_powertrain_schedule_query(s, children[1], raQueryInertiaNext);
+    } else if (from == 1) {
+        return inertia_prev + ra_powertrain_schedule_query(s, children[0], raQueryInertiaNext);
+    } else {
+        fprintf(stderr, "Incorrect previous inertia component");
         exit(EXIT_FAILURE);
     }
+}
+
+static void diff_flat_send_torque(
+    raPowertrainSchedule* s, size_t node, raVelocities v, float torque, float dt)
+{
+    SUPPRESS_UNUSED(v);
+    SUPPRESS_UNUSED(dt);
+    const size_t* children = s->nodes[node].children;
+
+    float react_left = ra_powertrain_schedule_query(s, children[0], raQueryExternalTorque);
+    float react_right = ra_powertrain_schedule_query(s, children[1], raQueryExternalTorque);
+
+    float torque_left, torque_right;
+    differential_torque((Differential*)s->nodes[node].c->ty, torque, react_left, react_right,
+        &torque_left, &torque_right);
 
+    ra_powertrain_schedule_pass_torque(s, node, 0, torque_left);
+    ra_powertrain_schedule_pass_torque(s, node, 1, torque_right);
+}
+
+static int diff_inertia_key(raTaggedComponent* t) { return (int)((Differential*)t->ty)->ty; }
+
+static const raFlatOps diff_flat_ops = {
+    .needs_children = flat_needs_children,
+    .query = diff_flat_query,
+    .inertia_prev = diff_flat_inertia_prev,
+    .send_torque = diff_flat_send_torque,
+    .receive_torque = NULL,
+    .inertia_key = diff_inertia_key,
+};
+
+Differential* differential_clone(raAllocator* a, const Differential* diff)
+{
+    Differential* clone = ra_alloc(a, sizeof *clone);
+    *clone = *diff;
+    return clone;
+}
+
+static void* diff_clone_ty(raAllocator* a, const void* diff, bool share)
+{
+    SUPPRESS_UNUSED(share);
+    return differential_clone(a, (const Differential*)diff);
+}
+
+static const raComponentOps diff_ops = {
+    .inertia_fn = diff_inertia,
+    .angular_velocity_fn = diff_angular_vel,
+    .send_torque_fn = diff_send_torque,
+    .receive_torque = NULL,
+    .update_angular_velocity = diff_update_angular_velocity,
+    .external_torque = diff_ext_torque,
+    .free_fn = NULL,
+    .free_in_fn = ra_free,
+    .clone_fn = diff_clone_ty,
+    .flat_ops = &diff_flat_ops,
+};
+
+raTaggedComponent* ra_tag_differential(Differential* diff)
+{
+    return ra_tag_differential_in(&ra_heap_allocator, diff);
+}
+
+raTaggedComponent* ra_tag_differential_in(raAllocator* a, Differential* diff)
+{
+    return ra_tagged_new_with_ops(a, diff, raTySplit, &diff_ops);
+}
+
+Gearbox* gearbox_new(VecFloat ratios, VecFloat inertias)
+{
+    return gearbox_new_in(&ra_heap_allocator, ratios, inertias);
+}
+
+Gearbox* gearbox_new_in(raAllocator* a, VecFloat ratios, VecFloat inertias)
+{
+    Gearbox* gb = ra_alloc(a, sizeof *gb);
+    gb->allocator = a;
     gb->ratios = ratios;
     gb->inertias = inertias;
     gb->curr_gear = 0;
@@ -262,11 +582,21 @@ Gearbox* gearbox_new(VecFloat ratios, VecFloat inertias)
     return gb;
 }
 
+Gearbox* gearbox_clone(raAllocator* a, const Gearbox* gb, bool share)
+{
+    Gearbox* clone = ra_alloc(a, sizeof *clone);
+    *clone = *gb;
+    clone->allocator = a;
+    clone->ratios = share ? vec_borrow(&gb->ratios) : vec_clone_in(a, &gb->ratios);
+    clone->inertias = share ? vec_borrow(&gb->inertias) : vec_clone_in(a, &gb->inertias);
+    return clone;
+}
+
 void gearbox_free(Gearbox* gb)
 {
     vec_free(&gb->ratios);
     vec_free(&gb->inertias);
-    free(gb);
+    ra_free(gb->allocator, gb);
 }
 
 static float gearbox_current_gear(const Gearbox* gb, const VecFloat* vec)
@@ -342,24 +672,94 @@ static float gb_tagged_inertia(raTaggedComponent* t, raTaggedComponent* prev, ra
     }
 }
 
-raTaggedComponent* ra_tag_gearbox(Gearbox* gb)
+static float gb_flat_query(
+    raPowertrainSchedule* s, size_t node, raQuery q, const float children[2])
+{
+    Gearbox* gb = (Gearbox*)s->nodes[node].c->ty;
+    switch (q) {
+    case raQueryExternalTorque:
+        return children[0];
+    case raQueryInertiaNext:
+        return gearbox_inertia(gb) + children[0];
+    default:
+        return gearbox_angular_velocity_in(gb, children[0]);
+    }
+}
+
+static float gb_flat_inertia_prev(raPowertrainSchedule* s, size_t node, float up, int from)
+{
+    SUPPRESS_UNUSED(from);
+    return gearbox_inertia((Gearbox*)s->nodes[node].c->ty) + up;
+}
+
+static void gb_flat_send_torque(
+    raPowertrainSchedule* s, size_t node, raVelocities v, float torque, float dt)
+{
+    SUPPRESS_UNUSED(v);
+    SUPPRESS_UNUSED(dt);
+    float gb_torque = gearbox_torque_out((Gearbox*)s->nodes[node].c->ty, torque);
+    ra_powertrain_schedule_pass_torque(s, node, 0, gb_torque);
+}
+
+static int gb_inertia_key(raTaggedComponent* t) { return ((Gearbox*)t->ty)->curr_gear; }
+
+static const raFlatOps gb_flat_ops = {
+    .needs_children = flat_needs_children,
+    .query = gb_flat_query,
+    .inertia_prev = gb_flat_inertia_prev,
+    .send_torque = gb_flat_send_torque,
+    .receive_torque = NULL,
+    .inertia_key = gb_inertia_key,
+};
+
+static void gearbox_free_in(raAllocator* a, void* gb)
 {
-    return ra_tagged_new(gb, gb_tagged_inertia, gb_angular_vel, gearbox_send_torque, NULL,
-        gb_update_angular_velocity, normal_ext_torque, (void (*)(void*))gearbox_free);
+    // The gearbox knows its own allocator
+    SUPPRESS_UNUSED(a);
+    gearbox_free((Gearbox*)gb);
+}
+
+static void* gearbox_clone_ty(raAllocator* a, const void* gb, bool share)
+{
+    return gearbox_clone(a, (const Gearbox*)gb, share);
+}
+
+static const raComponentOps gb_ops = {
+    .inertia_fn = gb_tagged_inertia,
+    .angular_velocity_fn = gb_angular_vel,
+    .send_torque_fn = gearbox_send_torque,
+    .receive_torque = NULL,
+    .update_angular_velocity = gb_update_angular_velocity,
+    .external_torque = normal_ext_torque,
+    .free_fn = NULL,
+    .free_in_fn = gearbox_free_in,
+    .clone_fn = gearbox_clone_ty,
+    .flat_ops = &gb_flat_ops,
+};
+
+raTaggedComponent* ra_tag_gearbox(Gearbox* gb) { return ra_tag_gearbox_in(&ra_heap_allocator, gb); }
+
+raTaggedComponent* ra_tag_gearbox_in(raAllocator* a, Gearbox* gb)
+{
+    return ra_tagged_new_with_ops(a, gb, raTyNormal, &gb_ops);
 }
 
 // Calculate max normal force from desired torque caracheristics of the clutch.
 Clutch* clutch_with_torque(
     float* max_normal_force, float max_static_torque, float max_kinetic_torque)
+{
+    return clutch_with_torque_in(
+        &ra_heap_allocator, max_normal_force, max_static_torque, max_kinetic_torque);
+}
+
+Clutch* clutch_with_torque_in(raAllocator* a, float* max_normal_force, float max_static_torque,
+    float max_kinetic_torque)
 {
     *max_normal_force = max_static_torque;
     float static_coefficient = 1.0f;
     float kinetic_coefficient = max_kinetic_torque / *max_normal_force;
 
-    Clutch* c = malloc(sizeof *c);
-    if (c == NULL) {
-        exit(EXIT_FAILURE);
-    }
+    Clutch* c = ra_alloc(a, sizeof *c);
 
     c->static_coefficient = static_coefficient;
     c->kinetic_coefficient = kinetic_coefficient;
@@ -369,23 +769,35 @@ Clutch* clutch_with_torque(
     return c;
 }
 
-static ClutchTagged* clutch_tagged_new(Clutch* c)
+Clutch* clutch_clone(raAllocator* a, const Clutch* c)
 {
-    ClutchTagged* ct = malloc(sizeof *ct);
-    if (ct == NULL) {
-        exit(EXIT_FAILURE);
-    }
+    Clutch* clone = ra_alloc(a, sizeof *clone);
+    *clone = *c;
+    return clone;
+}
+
+static ClutchTagged* clutch_tagged_new(raAllocator* a, Clutch* c)
+{
+    ClutchTagged* ct = ra_alloc(a, sizeof *ct);
     ct->c = c;
     ct->curr_normal_force = 0.0f;
     return ct;
 }
 
-static void clutch_tagged_free(void* ty)
+static void clutch_tagged_free(raAllocator* a, void* ty)
 {
     ClutchTagged* t = ((ClutchTagged*)ty);
-    free(t->c);
-    free(t);
-    ty = NULL;
+    ra_free(a, t->c);
+    ra_free(a, t);
+}
+
+static void* clutch_tagged_clone(raAllocator* a, const void* ty, bool share)
+{
+    SUPPRESS_UNUSED(share);
+    const ClutchTagged* t = (const ClutchTagged*)ty;
+    ClutchTagged* clone = clutch_tagged_new(a, clutch_clone(a, t->c));
+    clone->curr_normal_force = t->curr_normal_force;
+    return clone;
 }
 
 static inline float tanh_friction(float torque, AngularVelocity vel_diff, float transition)
@@ -465,8 +877,9 @@ static float clutch_ext_torque(raTaggedComponent* t)
 {
     ClutchTagged* ct = (ClutchTagged*)t->ty;
     if (!ct->c->is_locked) {
-        // TODO:
-        exit(EXIT_FAILURE);
+        // A slipping clutch separates the shafts. The torque it passes back is the friction torque
+        // sent to the engine by clutch_send_torque, not the external torque of the output shaft.
+        return 0.0;
     } else {
         return ra_tagged_external_torque(t->tty.normal.next);
     }
@@ -478,9 +891,94 @@ static float clutch_angular_velocity(raTaggedComponent* t)
     return ra_tagged_angular_velocity(t->tty.normal.next);
 }
 
-raTaggedComponent* ra_tag_clutch(Clutch* c)
+static bool clutch_flat_needs_children(raTaggedComponent* t, raQuery q)
+{
+    // A slipping clutch separates the shafts, except for the angular velocity which is always
+    // taken from the output shaft
+    return q == raQueryAngularVelocity || ((ClutchTagged*)t->ty)->c->is_locked;
+}
+
+static float clutch_flat_query(
+    raPowertrainSchedule* s, size_t node, raQuery q, const float children[2])
+{
+    ClutchTagged* ct = (ClutchTagged*)s->nodes[node].c->ty;
+    switch (q) {
+    case raQueryUpdateAngularVelocity:
+        if (!ct->c->is_locked) {
+            return ra_powertrain_schedule_query(
+                s, s->nodes[node].parent, raQueryAngularVelocity);
+        }
+        return children[0];
+    case raQueryExternalTorque:
+        // Same as clutch_ext_torque, nothing gets through while slipping
+        return ct->c->is_locked ? children[0] : 0.0f;
+    case raQueryInertiaNext:
+        return ct->c->is_locked ? children[0] : 0.0f;
+    default:
+        return children[0];
+    }
+}
+
+static float clutch_flat_inertia_prev(raPowertrainSchedule* s, size_t node, float up, int from)
+{
+    SUPPRESS_UNUSED(from);
+    return ((ClutchTagged*)s->nodes[node].c->ty)->c->is_locked ? up : 0.0f;
+}
+
+static void clutch_flat_send_torque(
+    raPowertrainSchedule* s, size_t node, raVelocities v, float torque, float dt)
+{
+    SUPPRESS_UNUSED(v);
+    SUPPRESS_UNUSED(dt);
+    const raScheduleNode* n = &s->nodes[node];
+    ClutchTagged* ct = (ClutchTagged*)n->c->ty;
+    float torque_left, torque_right;
+    bool was_locked = ct->c->is_locked;
+
+    float left_vel = ra_powertrain_schedule_query(s, n->parent, raQueryAngularVelocity);
+    float right_vel = ra_powertrain_schedule_query(s, n->children[0], raQueryAngularVelocity);
+    clutch_torque_out(
+        ct->c, torque, ct->curr_normal_force, left_vel, right_vel, &torque_left, &torque_right);
+    if (ct->c->is_locked != was_locked) {
+        ra_powertrain_schedule_invalidate_inertia(s);
+    }
+
+    ra_powertrain_schedule_pass_torque(s, node, 0, torque_right);
+    if (!ct->c->is_locked) {
+        ra_powertrain_schedule_receive_torque(s, n->parent, torque_left);
+    }
+}
+
+static int clutch_inertia_key(raTaggedComponent* t)
+{
+    return ((ClutchTagged*)t->ty)->c->is_locked;
+}
+
+static const raFlatOps clutch_flat_ops = {
+    .needs_children = clutch_flat_needs_children,
+    .query = clutch_flat_query,
+    .inertia_prev = clutch_flat_inertia_prev,
+    .send_torque = clutch_flat_send_torque,
+    .receive_torque = NULL,
+    .inertia_key = clutch_inertia_key,
+};
+
+static const raComponentOps clutch_ops = {
+    .inertia_fn = clutch_inertia,
+    .angular_velocity_fn = clutch_angular_velocity,
+    .send_torque_fn = clutch_send_torque,
+    .receive_torque = NULL,
+    .update_angular_velocity = clutch_update_angular_velocity,
+    .external_torque = clutch_ext_torque,
+    .free_fn = NULL,
+    .free_in_fn = clutch_tagged_free,
+    .clone_fn = clutch_tagged_clone,
+    .flat_ops = &clutch_flat_ops,
+};
+
+raTaggedComponent* ra_tag_clutch(Clutch* c) { return ra_tag_clutch_in(&ra_heap_allocator, c); }
+
+raTaggedComponent* ra_tag_clutch_in(raAllocator* a, Clutch* c)
 {
-    return ra_tagged_new(clutch_tagged_new(c), clutch_inertia, clutch_angular_velocity,
-        clutch_send_torque, NULL, clutch_update_angular_velocity, clutch_ext_torque,
-        clutch_tagged_free);
+    return ra_tagged_new_with_ops(a, clutch_tagged_new(a, c), raTyNormal, &clutch_ops);
 }
@@ -4,6 +4,22 @@
 #include "powertrainabs.h"
 #include <stdbool.h>
 
+/** The torque map prepared for the per step lookups by `engine_compile`. Holds the reciprocal of
+ * every axis segment, the slope of each map row along rpm, and the closed (0.0) and wide open
+ * (1.0) throttle torque as piecewise linear functions of rpm. */
+typedef struct {
+    float* inv_dx;
+    float* inv_dy;
+    /** Row major, x_capacity rows of y_capacity - 1 slopes */
+    float* slope;
+    float* min_torque;
+    float* min_slope;
+    float* max_torque;
+    float* max_slope;
+    /** False when borrowed from another engine by `engine_clone` */
+    bool owned;
+} EngineCurves;
+
 typedef struct {
     /**
      * `x` is the throttle position from 0.0 to 1.0
@@ -11,15 +27,37 @@ typedef struct {
      * `z` is torque from 0.0 to 1.0
      * */
     Table torque_map;
+    EngineCurves curves;
+    /** Rpm and throttle change little between steps, so lookups start where the last one ended */
+    TableCursor torque_cursor;
     AngularVelocity angular_velocity;
     float inertia;
+    raAllocator* allocator;
 } Engine;
 
+/** Takes ownership of `torque_map` and compiles it. A view made with `table_view` or
+ * `table_borrow` is not freed by `engine_free`, so one map can be shared between engines. */
 Engine* engine_new(float inertia, Table torque_map);
+/** Same as `engine_new`, with the engine and its curves allocated from `a` */
+Engine* engine_new_in(raAllocator* a, float inertia, Table torque_map);
+/** Rebuilds `curves` from `torque_map`. Must be called again if the torque map is modified after
+ * `engine_new`. Torque is interpolated bilinearly like `table_lookup` but the order of operations
+ * differs, so results may differ from it in the last bits. Closed and wide open throttle torque
+ * from the curves is identical to `engine_torque` at 0.0 and 1.0 as long as 0.0 and 1.0 are
+ * breakpoints of the map. */
+void engine_compile(Engine* engine);
 raTaggedComponent* ra_tag_engine(Engine* engine);
+raTaggedComponent* ra_tag_engine_in(raAllocator* a, Engine* engine);
+/** Copies the engine and its state into `a`. With `share` the torque map and its curves are shared
+ * with `engine`, which must then outlive the clone. */
+Engine* engine_clone(raAllocator* a, const Engine* engine, bool share);
 void engine_free(Engine* engine);
 float engine_torque(Engine* engine, float throttle_pos);
 void engine_set_angular_velocity(Engine* engine, AngularVelocity velocity);
+/** Torque at closed throttle for the current angular velocity */
+float engine_min_torque(Engine* engine);
+/** Torque at wide open throttle for the current angular velocity */
+float engine_max_torque(Engine* engine);
 
 /**Calculates torque needed to reach desired velocity. If desired velocity cannot
  be reached, then the max possible torque will be returned.*/
@@ -55,7 +93,11 @@ typedef struct {
 } Differential;
 
 Differential* differential_new(float ratio, float inertia, DiffType ty);
+Differential* differential_new_in(raAllocator* a, float ratio, float inertia, DiffType ty);
+Differential* differential_clone(raAllocator* a, const Differential* diff);
 raTaggedComponent* ra_tag_differential(Differential* diff);
+/** The differential is freed with `a` along with the component */
+raTaggedComponent* ra_tag_differential_in(raAllocator* a, Differential* diff);
 void differential_torque(Differential* diff, float input_torque, float reaction_torque_left,
     float reaction_torque_right, float* output_left_torque, float* output_right_torque);
 float differential_velocity(
@@ -66,11 +108,17 @@ typedef struct {
     float input_angular_velocity;
     VecFloat ratios;
     VecFloat inertias;
+    raAllocator* allocator;
 } Gearbox;
 
 /**Reverse ratio/inertia is the first element in the lists*/
 Gearbox* gearbox_new(VecFloat ratios, VecFloat inertias);
+Gearbox* gearbox_new_in(raAllocator* a, VecFloat ratios, VecFloat inertias);
+/** Copies the gearbox and its state into `a`. With `share` the ratios and inertias are shared with
+ * `gb`, which must then outlive the clone. */
+Gearbox* gearbox_clone(raAllocator* a, const Gearbox* gb, bool share);
 raTaggedComponent* ra_tag_gearbox(Gearbox* gb);
+raTaggedComponent* ra_tag_gearbox_in(raAllocator* a, Gearbox* gb);
 void gearbox_free(Gearbox* gb);
 void gearbox_upshift(Gearbox* gb);
 void gearbox_downshift(Gearbox* gb);
@@ -88,8 +136,13 @@ typedef struct {
 
 Clutch* clutch_with_torque(
     float* max_normal_force, float max_static_torque, float max_kinetic_torque);
+Clutch* clutch_with_torque_in(raAllocator* a, float* max_normal_force, float max_static_torque,
+    float max_kinetic_torque);
+Clutch* clutch_clone(raAllocator* a, const Clutch* c);
 
 raTaggedComponent* ra_tag_clutch(Clutch* c);
+/** The clutch is freed with `a` along with the component */
+raTaggedComponent* ra_tag_clutch_in(raAllocator* a, Clutch* c);
 void clutch_torque_out(Clutch* clutch, float torque_in, float normal_force,
     AngularVelocity left_vel, AngularVelocity right_vel, float* torque_left, float* torque_right);
 
@@ -3,9 +3,49 @@
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 void* ra_tagged_component_inner(raTaggedComponent* c) { return c->ty; }
 
+static raTaggedComponent* tagged_init(raTaggedComponent* t, raAllocator* a, void* ty,
+    enum raTy comp_ty, const raComponentOps* ops)
+{
+    assert(ty != NULL);
+
+    t->comp_ty = comp_ty;
+    t->ty = ty;
+    t->prev = NULL;
+    t->ops = ops;
+    t->owned_ops = NULL;
+    t->allocator = a;
+    if (comp_ty == raTySplit) {
+        t->tty.split = (raSplitComponent) { .next_left = NULL, .next_right = NULL };
+    } else {
+        t->tty.normal = (raComponent) { .next = NULL };
+    }
+
+    return t;
+}
+
+raTaggedComponent* ra_tagged_new_with_ops(
+    raAllocator* a, void* ty, enum raTy comp_ty, const raComponentOps* ops)
+{
+    return tagged_init(ra_alloc(a, sizeof(raTaggedComponent)), a, ty, comp_ty, ops);
+}
+
+/** For components made from separate callbacks. The callbacks are stored right after the
+ * component in the same allocation. */
+static raTaggedComponent* tagged_new_own_ops(
+    raAllocator* a, void* ty, enum raTy comp_ty, raComponentOps ops)
+{
+    raTaggedComponent* t = ra_alloc(a, sizeof *t + sizeof ops);
+    raComponentOps* owned = (raComponentOps*)(t + 1);
+    *owned = ops;
+    tagged_init(t, a, ty, comp_ty, owned);
+    t->owned_ops = owned;
+    return t;
+}
+
 raTaggedComponent* ra_tagged_new(void* ty,
     float (*inertia_fn)(raTaggedComponent* t, raTaggedComponent* prev, raInertiaDirection d),
     float (*angular_velocity)(raTaggedComponent* t),
@@ -14,28 +54,38 @@ raTaggedComponent* ra_tagged_new(void* ty,
     float (*update_angular_velocity)(raTaggedComponent* t),
     float (*external_torque)(raTaggedComponent* t), void (*free_fn)(void* ptr))
 {
-    assert(ty != NULL);
     assert(free_fn != NULL);
 
-    raTaggedComponent* t = malloc(sizeof *t);
-    if (t == NULL) {
-        abort();
-    }
-    t->comp_ty = raTyNormal;
-    t->ty = ty;
-    t->free_fn = free_fn;
-    t->inertia_fn = inertia_fn;
-    t->angular_velocity_fn = angular_velocity;
-    t->send_torque_fn = send_torque_fn, t->prev = NULL;
-    t->receive_torque = receive_torque;
-    t->update_angular_velocity = update_angular_velocity;
-    t->external_torque = external_torque;
-
-    t->tty.normal = (raComponent) {
-        .next = NULL,
-    };
+    return tagged_new_own_ops(&ra_heap_allocator, ty, raTyNormal,
+        (raComponentOps) {
+            .inertia_fn = inertia_fn,
+            .angular_velocity_fn = angular_velocity,
+            .send_torque_fn = send_torque_fn,
+            .receive_torque = receive_torque,
+            .update_angular_velocity = update_angular_velocity,
+            .external_torque = external_torque,
+            .free_fn = free_fn,
+        });
+}
 
-    return t;
+raTaggedComponent* ra_tagged_new_in(raAllocator* a, void* ty,
+    float (*inertia_fn)(raTaggedComponent* t, raTaggedComponent* prev, raInertiaDirection d),
+    float (*angular_velocity)(raTaggedComponent* t),
+    void (*send_torque_fn)(raTaggedComponent* t, raVelocities v, float torque, float dt),
+    void (*receive_torque)(raTaggedComponent* t, float torque, float dt),
+    float (*update_angular_velocity)(raTaggedComponent* t),
+    float (*external_torque)(raTaggedComponent* t), void (*free_fn)(raAllocator* a, void* ptr))
+{
+    return tagged_new_own_ops(a, ty, raTyNormal,
+        (raComponentOps) {
+            .inertia_fn = inertia_fn,
+            .angular_velocity_fn = angular_velocity,
+            .send_torque_fn = send_torque_fn,
+            .receive_torque = receive_torque,
+            .update_angular_velocity = update_angular_velocity,
+            .external_torque = external_torque,
+            .free_in_fn = free_fn,
+        });
 }
 
 static bool has_cycle(raTaggedComponent* c, raTaggedComponent* prev)
@@ -80,26 +130,36 @@ raTaggedComponent* ra_tagged_split_new(void* ty,
     float (*update_angular_velocity)(raTaggedComponent* t),
     float (*external_torque)(raTaggedComponent* t), void (*free_fn)(void* ptr))
 {
-    raTaggedComponent* t = malloc(sizeof *t);
-    if (t == NULL) {
-        abort();
-    }
-    t->comp_ty = raTySplit;
-    t->ty = ty;
-    t->free_fn = free_fn;
-    t->inertia_fn = inertia_fn;
-    t->angular_velocity_fn = angular_velocity;
-    t->send_torque_fn = send_torque_fn, t->prev = NULL;
-    t->receive_torque = receive_torque;
-    t->update_angular_velocity = update_angular_velocity;
-    t->external_torque = external_torque;
-
-    t->tty.split = (raSplitComponent) {
-        .next_left = NULL,
-        .next_right = NULL,
-    };
+    return tagged_new_own_ops(&ra_heap_allocator, ty, raTySplit,
+        (raComponentOps) {
+            .inertia_fn = inertia_fn,
+            .angular_velocity_fn = angular_velocity,
+            .send_torque_fn = send_torque_fn,
+            .receive_torque = receive_torque,
+            .update_angular_velocity = update_angular_velocity,
+            .external_torque = external_torque,
+            .free_fn = free_fn,
+        });
+}
 
-    return t;
+raTaggedComponent* ra_tagged_split_new_in(raAllocator* a, void* ty,
+    float (*inertia_fn)(raTaggedComponent* t, raTaggedComponent* prev, raInertiaDirection d),
+    float (*angular_velocity)(raTaggedComponent* t),
+    void (*send_torque_fn)(raTaggedComponent* t, raVelocities v, float torque, float dt),
+    void (*receive_torque)(raTaggedComponent* t, float torque, float dt),
+    float (*update_angular_velocity)(raTaggedComponent* t),
+    float (*external_torque)(raTaggedComponent* t), void (*free_fn)(raAllocator* a, void* ptr))
+{
+    return tagged_new_own_ops(a, ty, raTySplit,
+        (raComponentOps) {
+            .inertia_fn = inertia_fn,
+            .angular_velocity_fn = angular_velocity,
+            .send_torque_fn = send_torque_fn,
+            .receive_torque = receive_torque,
+            .update_angular_velocity = update_angular_velocity,
+            .external_torque = external_torque,
+            .free_in_fn = free_fn,
+        });
 }
 
 RaErrorTaggedComponent ra_tagged_add_next_left(raTaggedComponent* t, raTaggedComponent* next)
@@ -164,9 +224,13 @@ void ra_tagged_component_free(raTaggedComponent* c)
             abort();
         }
 
-        c->free_fn(c->ty);
+        if (c->ops->free_in_fn != NULL) {
+            c->ops->free_in_fn(c->allocator, c->ty);
+        } else if (c->ops->free_fn != NULL) {
+            c->ops->free_fn(c->ty);
+        }
 
-        free(c);
+        ra_free(c->allocator, c);
     }
 }
 
@@ -191,14 +255,17 @@ static void ra_free_split_component(raSplitComponent* c)
 // TODO: Growable list
 raPowertrainSystem ra_powertrain_system_new(size_t max_subsystems)
 {
-    raTaggedComponent** subsystems = malloc(max_subsystems * sizeof *subsystems);
-    if (subsystems == NULL) {
-        abort();
-    }
+    return ra_powertrain_system_new_in(&ra_heap_allocator, max_subsystems);
+}
+
+raPowertrainSystem ra_powertrain_system_new_in(raAllocator* a, size_t max_subsystems)
+{
+    raTaggedComponent** subsystems = ra_alloc(a, max_subsystems * sizeof *subsystems);
 
     return (raPowertrainSystem) {
         .num_subsystems = max_subsystems,
         .subsystems = subsystems,
+        .allocator = a,
     };
 }
 
@@ -223,7 +290,7 @@ void ra_powertrain_system_free(raPowertrainSystem o)
     for (size_t i = 0; i < o.num_subsystems; i++) {
         ra_tagged_component_free(o.subsystems[i]);
     }
-    free(o.subsystems);
+    ra_free(o.allocator, o.subsystems);
 
     o.num_subsystems = 0;
     o.subsystems = NULL;
@@ -235,24 +302,24 @@ float ra_tagged_inertia(raTaggedComponent* t, raTaggedComponent* prev, raInertia
     if (t == NULL) {
         return 0.0f;
     } else {
-        return t->inertia_fn(t, prev, d);
+        return t->ops->inertia_fn(t, prev, d);
     }
 }
 
-float ra_tagged_angular_velocity(raTaggedComponent* t) { return t->angular_velocity_fn(t); }
+float ra_tagged_angular_velocity(raTaggedComponent* t) { return t->ops->angular_velocity_fn(t); }
 void ra_tagged_send_torque(raTaggedComponent* t, float torque, raVelocities v, float dt)
 {
-    t->send_torque_fn(t, v, torque, dt);
+    t->ops->send_torque_fn(t, v, torque, dt);
 }
 
 void ra_tagged_receive_torque(raTaggedComponent* t, float torque, float dt)
 {
-    t->receive_torque(t, torque, dt);
+    t->ops->receive_torque(t, torque, dt);
 }
 
 float ra_tagged_update_angular_velocity(raTaggedComponent* t)
 {
-    return t->update_angular_velocity(t);
+    return t->ops->update_angular_velocity(t);
 }
 
 float ra_tagged_external_torque(raTaggedComponent* t)
@@ -260,6 +327,440 @@ float ra_tagged_external_torque(raTaggedComponent* t)
     if (t == NULL) {
         return 0.0;
     } else {
-        return t->external_torque(t);
+        return t->ops->external_torque(t);
+    }
+}
+
+static size_t num_children(raTaggedComponent* c) { return c->comp_ty == raTySplit ? 2 : 1; }
+
+static raTaggedComponent* child(raTaggedComponent* c, size_t slot)
+{
+    if (c->comp_ty == raTySplit) {
+        return slot == 0 ? c->tty.split.next_left : c->tty.split.next_right;
+    } else {
+        return c->tty.normal.next;
+    }
+}
+
+static int slot_of(raTaggedComponent* parent, raTaggedComponent* c)
+{
+    return parent->comp_ty == raTySplit && parent->tty.split.next_right == c ? 1 : 0;
+}
+
+/** The component after `c` in depth first order within the subsystem starting at `root`, or NULL.
+ * Walks back up through `prev` instead of keeping a stack. */
+static raTaggedComponent* next_in_order(raTaggedComponent* root, raTaggedComponent* c)
+{
+    for (size_t i = 0; i < num_children(c); i++) {
+        if (child(c, i) != NULL) {
+            return child(c, i);
+        }
+    }
+
+    while (c != root) {
+        raTaggedComponent* parent = c->prev;
+        for (size_t i = (size_t)slot_of(parent, c) + 1; i < num_children(parent); i++) {
+            if (child(parent, i) != NULL) {
+                return child(parent, i);
+            }
+        }
+        c = parent;
+    }
+
+    return NULL;
+}
+
+static raTaggedComponent* clone_component(
+    raAllocator* a, raTaggedComponent* c, bool share, raTaggedComponent* prev)
+{
+    raTaggedComponent* t;
+    if (c->owned_ops != NULL) {
+        t = tagged_new_own_ops(a, c->ty, c->comp_ty, *c->owned_ops);
+    } else {
+        t = ra_tagged_new_with_ops(a, c->ty, c->comp_ty, c->ops);
+    }
+    t->ty = c->ops->clone_fn(a, c->ty, share);
+    t->prev = prev;
+
+    if (prev == NULL) {
+        return t;
+    } else if (prev->comp_ty != raTySplit) {
+        prev->tty.normal.next = t;
+    } else if (slot_of(c->prev, c) == 0) {
+        prev->tty.split.next_left = t;
+    } else {
+        prev->tty.split.next_right = t;
+    }
+
+    return t;
+}
+
+/** Clones the subsystem starting at `root`. Walks it like `next_in_order`, moving through the
+ * clones in lockstep so the clone of each parent is at hand without a map. */
+static raTaggedComponent* clone_subsystem(raAllocator* a, raTaggedComponent* root, bool share)
+{
+    raTaggedComponent* clone_root = clone_component(a, root, share, NULL);
+    raTaggedComponent* c = root;
+    raTaggedComponent* clone = clone_root;
+    size_t first = 0;
+
+    while (true) {
+        bool descended = false;
+        for (size_t i = first; i < num_children(c) && !descended; i++) {
+            if (child(c, i) != NULL) {
+                c = child(c, i);
+                clone = clone_component(a, c, share, clone);
+                descended = true;
+            }
+        }
+
+        if (descended) {
+            first = 0;
+        } else if (c == root) {
+            return clone_root;
+        } else {
+            // Continue with the next sibling
+            first = (size_t)slot_of(c->prev, c) + 1;
+            c = c->prev;
+            clone = clone->prev;
+        }
+    }
+}
+
+RaErrorTaggedComponent ra_powertrain_system_clone(
+    raPowertrainSystem sys, raAllocator* a, bool share, raPowertrainSystem* clone)
+{
+    for (size_t r = 0; r < sys.num_subsystems; r++) {
+        raTaggedComponent* root = sys.subsystems[r];
+        for (raTaggedComponent* c = root; c != NULL; c = next_in_order(root, c)) {
+            if (c->ops->clone_fn == NULL || c->ops->free_in_fn == NULL) {
+                return RaErrorTaggedNotClonable;
+            }
+        }
+    }
+
+    raPowertrainSystem s = ra_powertrain_system_new_in(a, sys.num_subsystems);
+    for (size_t r = 0; r < sys.num_subsystems; r++) {
+        s.subsystems[r] = clone_subsystem(a, sys.subsystems[r], share);
+    }
+
+    *clone = s;
+    return 0;
+}
+
+/** Zeroed, so stamps start out invalid */
+static void* schedule_alloc(raAllocator* a, size_t n, size_t size)
+{
+    void* p = ra_alloc(a, n * size);
+    memset(p, 0, n * size);
+    return p;
+}
+
+RaErrorTaggedComponent ra_powertrain_schedule_compile(
+    raPowertrainSystem sys, raAllocator* a, raPowertrainSchedule* schedule)
+{
+    size_t n = 0;
+    for (size_t r = 0; r < sys.num_subsystems; r++) {
+        raTaggedComponent* root = sys.subsystems[r];
+        for (raTaggedComponent* c = root; c != NULL; c = next_in_order(root, c)) {
+            if (c->ops->flat_ops == NULL) {
+                return RaErrorTaggedNotCompilable;
+            }
+            n++;
+        }
+    }
+
+    raPowertrainSchedule s = {
+        .num_nodes = n,
+        .nodes = schedule_alloc(a, n, sizeof(raScheduleNode)),
+        .num_roots = sys.num_subsystems,
+        .roots = schedule_alloc(a, sys.num_subsystems, sizeof(size_t)),
+        .torque = schedule_alloc(a, n, sizeof(float)),
+        .reached = schedule_alloc(a, n, sizeof(bool)),
+        .path = schedule_alloc(a, n, sizeof(size_t)),
+        .receives = schedule_alloc(a, n, sizeof(raScheduleReceive)),
+        .num_receives = 0,
+        .inertia_generation = 1,
+        .inertia_keys = schedule_alloc(a, n, sizeof(int)),
+        .inertia_prev = schedule_alloc(a, n * 3, sizeof(float)),
+        .inertia_prev_stamp = schedule_alloc(a, n * 3, sizeof(unsigned)),
+        .inertia_next = schedule_alloc(a, n, sizeof(float)),
+        .inertia_next_stamp = schedule_alloc(a, n, sizeof(unsigned)),
+        .allocator = a,
+    };
+
+    for (size_t q = 0; q < raNumQueries; q++) {
+        s.values[q] = schedule_alloc(a, n, sizeof(float));
+        s.needed[q] = schedule_alloc(a, n, sizeof(bool));
+        s.expand[q] = schedule_alloc(a, n, sizeof(bool));
+        s.stamp[q] = schedule_alloc(a, n, sizeof(unsigned));
+    }
+
+    size_t i = 0;
+    for (size_t r = 0; r < sys.num_subsystems; r++) {
+        raTaggedComponent* root = sys.subsystems[r];
+        s.roots[r] = i;
+        for (raTaggedComponent* c = root; c != NULL; c = next_in_order(root, c), i++) {
+            raScheduleNode* node = &s.nodes[i];
+            node->c = c;
+            node->children[0] = SIZE_MAX;
+            node->children[1] = SIZE_MAX;
+            node->end = i + 1;
+            node->parent = SIZE_MAX;
+            node->slot = 0;
+
+            if (c != root) {
+                // The parent is the closest earlier node that c is a child of
+                size_t p = i - 1;
+                while (s.nodes[p].c != c->prev) {
+                    p--;
+                }
+                node->parent = p;
+                node->slot = slot_of(c->prev, c);
+                s.nodes[p].children[node->slot] = i;
+            }
+        }
+
+        // Children come after their parent, so going backwards every subtree is complete before
+        // its end is propagated to the parent
+        for (size_t j = i; j-- > s.roots[r];) {
+            size_t p = s.nodes[j].parent;
+            if (p != SIZE_MAX && s.nodes[j].end > s.nodes[p].end) {
+                s.nodes[p].end = s.nodes[j].end;
+            }
+        }
+    }
+
+    *schedule = s;
+    return 0;
+}
+
+void ra_powertrain_schedule_free(raPowertrainSchedule* s)
+{
+    if (s->allocator == NULL) {
+        return;
+    }
+
+    void* arrays[] = { s->nodes, s->roots, s->torque, s->reached, s->path, s->receives,
+        s->inertia_keys, s->inertia_prev, s->inertia_prev_stamp, s->inertia_next,
+        s->inertia_next_stamp };
+    for (size_t k = 0; k < sizeof arrays / sizeof arrays[0]; k++) {
+        ra_free(s->allocator, arrays[k]);
+    }
+    for (size_t q = 0; q < raNumQueries; q++) {
+        ra_free(s->allocator, s->values[q]);
+        ra_free(s->allocator, s->needed[q]);
+        ra_free(s->allocator, s->expand[q]);
+        ra_free(s->allocator, s->stamp[q]);
+    }
+
+    *s = (raPowertrainSchedule) { .num_nodes = 0 };
+}
+
+static bool is_memoized(raQuery q)
+{
+    return q == raQueryAngularVelocity || q == raQueryExternalTorque;
+}
+
+static float query(raPowertrainSchedule* s, size_t node, raQuery q)
+{
+    float* values = s->values[q];
+    bool* needed = s->needed[q];
+    bool* expand = s->expand[q];
+    unsigned* stamp = s->stamp[q];
+    size_t end = s->nodes[node].end;
+    bool memoize = s->sending && is_memoized(q);
+
+    if (memoize && stamp[node] == s->send_count) {
+        return values[node];
+    }
+
+    // Find out which nodes the answer depends on, parents are decided before their children.
+    // Nodes already answered during this send are needed but not computed again.
+    for (size_t i = node; i < end; i++) {
+        size_t p = s->nodes[i].parent;
+        needed[i] = i == node || (needed[p] && expand[p]);
+        raTaggedComponent* c = s->nodes[i].c;
+        bool known = memoize && stamp[i] == s->send_count;
+        expand[i] = needed[i] && !known && c->ops->flat_ops->needs_children(c, q);
+        if (known) {
+            needed[i] = false;
+        }
+    }
+
+    // Then answer them with every child answered before its parent
+    for (size_t i = end; i-- > node;) {
+        if (!needed[i]) {
+            continue;
+        }
+
+        const raScheduleNode* n = &s->nodes[i];
+        float children[2] = { 0.0f, 0.0f };
+        if (expand[i]) {
+            for (size_t k = 0; k < 2; k++) {
+                if (n->children[k] != SIZE_MAX) {
+                    children[k] = values[n->children[k]];
+                }
+            }
+        }
+
+        values[i] = n->c->ops->flat_ops->query(s, i, q, children);
+        if (memoize) {
+            stamp[i] = s->send_count;
+        }
+    }
+
+    return values[node];
+}
+
+float ra_powertrain_schedule_query(raPowertrainSchedule* s, size_t node, raQuery q)
+{
+    if (node == SIZE_MAX) {
+        return 0.0f;
+    } else if (q != raQueryInertiaNext) {
+        return query(s, node, q);
+    }
+
+    if (s->inertia_next_stamp[node] != s->inertia_generation) {
+        s->inertia_next[node] = query(s, node, q);
+        s->inertia_next_stamp[node] = s->inertia_generation;
+    }
+
+    return s->inertia_next[node];
+}
+
+static float inertia_prev(raPowertrainSchedule* s, size_t node, int from)
+{
+    size_t len = 0;
+    for (size_t i = node; i != SIZE_MAX; i = s->nodes[i].parent) {
+        s->path[len++] = i;
+    }
+
+    // From the first component down, each one sees the one before it
+    float up = 0.0f;
+    for (size_t k = len; k-- > 1;) {
+        size_t i = s->path[k];
+        up = s->nodes[i].c->ops->flat_ops->inertia_prev(s, i, up, s->nodes[s->path[k - 1]].slot);
+    }
+
+    return s->nodes[node].c->ops->flat_ops->inertia_prev(s, node, up, from);
+}
+
+float ra_powertrain_schedule_inertia_prev(raPowertrainSchedule* s, size_t node, int from)
+{
+    if (node == SIZE_MAX) {
+        return 0.0f;
+    }
+
+    size_t k = node * 3 + (size_t)(from + 1);
+    if (s->inertia_prev_stamp[k] != s->inertia_generation) {
+        s->inertia_prev[k] = inertia_prev(s, node, from);
+        s->inertia_prev_stamp[k] = s->inertia_generation;
+    }
+
+    return s->inertia_prev[k];
+}
+
+void ra_powertrain_schedule_invalidate_inertia(raPowertrainSchedule* s)
+{
+    s->inertia_generation++;
+    if (s->inertia_generation == 0) {
+        // Wrapped around, old stamps could be taken as valid
+        for (size_t i = 0; i < s->num_nodes; i++) {
+            s->inertia_next_stamp[i] = 0;
+            for (size_t k = 0; k < 3; k++) {
+                s->inertia_prev_stamp[i * 3 + k] = 0;
+            }
+        }
+        s->inertia_generation = 1;
+    }
+}
+
+static void check_inertia_keys(raPowertrainSchedule* s)
+{
+    bool changed = false;
+    for (size_t i = 0; i < s->num_nodes; i++) {
+        raTaggedComponent* c = s->nodes[i].c;
+        if (c->ops->flat_ops->inertia_key != NULL) {
+            int key = c->ops->flat_ops->inertia_key(c);
+            changed |= key != s->inertia_keys[i];
+            s->inertia_keys[i] = key;
+        }
+    }
+
+    if (changed) {
+        ra_powertrain_schedule_invalidate_inertia(s);
+    }
+}
+
+void ra_powertrain_schedule_pass_torque(
+    raPowertrainSchedule* s, size_t node, int slot, float torque)
+{
+    size_t c = s->nodes[node].children[slot];
+    if (c != SIZE_MAX) {
+        s->torque[c] = torque;
+        s->reached[c] = true;
+    }
+}
+
+void ra_powertrain_schedule_receive_torque(raPowertrainSchedule* s, size_t node, float torque)
+{
+    s->receives[s->num_receives++] = (raScheduleReceive) {
+        .end = s->nodes[s->current].end,
+        .node = node,
+        .torque = torque,
+    };
+}
+
+static void flush_receives(raPowertrainSchedule* s, size_t i)
+{
+    while (s->num_receives > 0 && s->receives[s->num_receives - 1].end <= i) {
+        raScheduleReceive r = s->receives[--s->num_receives];
+        s->nodes[r.node].c->ops->flat_ops->receive_torque(s, r.node, r.torque, s->dt);
+    }
+}
+
+void ra_powertrain_schedule_send_torque(
+    raPowertrainSchedule* s, size_t subsystem, float torque, raVelocities v, float dt)
+{
+    size_t root = s->roots[subsystem];
+    size_t end = s->nodes[root].end;
+    for (size_t i = root; i < end; i++) {
+        s->reached[i] = false;
+    }
+
+    s->torque[root] = torque;
+    s->reached[root] = true;
+    s->dt = dt;
+    check_inertia_keys(s);
+
+    s->send_count++;
+    if (s->send_count == 0) {
+        // Wrapped around, old stamps could be taken as valid
+        for (size_t q = 0; q < raNumQueries; q++) {
+            memset(s->stamp[q], 0, s->num_nodes * sizeof(unsigned));
+        }
+        s->send_count = 1;
+    }
+    s->sending = true;
+
+    for (size_t i = root; i < end; i++) {
+        flush_receives(s, i);
+        if (!s->reached[i]) {
+            continue;
+        }
+
+        s->current = i;
+        s->nodes[i].c->ops->flat_ops->send_torque(s, i, v, s->torque[i], dt);
+    }
+
+    flush_receives(s, SIZE_MAX);
+    s->sending = false;
+}
+
+void ra_powertrain_schedule_update_angular_velocity(raPowertrainSchedule* s)
+{
+    for (size_t r = 0; r < s->num_roots; r++) {
+        ra_powertrain_schedule_query(s, s->roots[r], raQueryUpdateAngularVelocity);
     }
 }
@@ -1,6 +1,8 @@
 #ifndef RA_POWERTRAIN_ABS_H
 #define RA_POWERTRAIN_ABS_H
 #include "common.h"
+#include <stdbool.h>
+#include <stdint.h>
 #include <sys/types.h>
 
 typedef enum {
@@ -10,6 +12,10 @@ typedef enum {
     RaErrorTaggedSame = -2,
     /**Component reaches itself. This will cause infinite recursion and double free.*/
     RaErrorTaggedCyclic = -3,
+    /**A component has no `raFlatOps`, so the powertrain can not be compiled into a schedule*/
+    RaErrorTaggedNotCompilable = -4,
+    /**A component has no `clone_fn` or was not made with an allocator, so it can not be cloned*/
+    RaErrorTaggedNotClonable = -5,
 } RaErrorTaggedComponent;
 
 typedef struct {
@@ -37,20 +43,77 @@ union raComponentTypes {
 
 typedef enum { raInertiaDirectionPrev, raInertiaDirectionNext } raInertiaDirection;
 
-struct raTaggedComponent {
-    void* ty;
-    raTaggedComponent* prev;
-    void (*free_fn)(void* ptr);
+typedef struct raPowertrainSchedule raPowertrainSchedule;
+
+/** The questions the schedule asks about a whole subtree. They match `ra_tagged_angular_velocity`,
+ * `ra_tagged_update_angular_velocity`, `ra_tagged_external_torque` and `ra_tagged_inertia` in the
+ * next direction. */
+typedef enum {
+    raQueryAngularVelocity,
+    raQueryUpdateAngularVelocity,
+    raQueryExternalTorque,
+    raQueryInertiaNext,
+    raNumQueries,
+} raQuery;
+
+/** Non-recursive versions of the component callbacks, used by `raPowertrainSchedule`. Instead of
+ * calling into the next components they get the answers of their children passed in, or ask the
+ * schedule. Children are numbered 0 for `next` and `next_left`, and 1 for `next_right`. */
+typedef struct {
+    /** Whether `query` needs the answers of the children of `t` in its current state */
+    bool (*needs_children)(raTaggedComponent* t, raQuery q);
+    /** Answers `q` for `node`. `children` holds the answers of the children if `needs_children`,
+     * and 0.0 for missing children. */
+    float (*query)(raPowertrainSchedule* s, size_t node, raQuery q, const float children[2]);
+    /** Inertia in the previous direction as seen from child `from`, or from the node itself when
+     * -1. `up` is the inertia in the previous direction of the node's own previous component. */
+    float (*inertia_prev)(raPowertrainSchedule* s, size_t node, float up, int from);
+    /** Passes torque on with `ra_powertrain_schedule_pass_torque`. Angular velocities and external
+     * torques asked for are the ones from before anything after the node was sent to. */
+    void (*send_torque)(
+        raPowertrainSchedule* s, size_t node, raVelocities v, float torque, float dt);
+    void (*receive_torque)(raPowertrainSchedule* s, size_t node, float torque, float dt);
+    /** Summarizes the state the inertias depend on, such as the current gear. The schedule caches
+     * inertias until a key changes. NULL if the inertia is constant. */
+    int (*inertia_key)(raTaggedComponent* t);
+} raFlatOps;
+
+/** The callbacks of a kind of component. They are the same for every component of the kind, so
+ * one constant table is shared by all of them instead of each carrying its own copy. */
+typedef struct {
     float (*inertia_fn)(raTaggedComponent* t, raTaggedComponent* prev, raInertiaDirection d);
     float (*angular_velocity_fn)(raTaggedComponent* t);
     void (*send_torque_fn)(raTaggedComponent* t, raVelocities v, float torque, float dt);
     void (*receive_torque)(raTaggedComponent* t, float torque, float dt);
     float (*update_angular_velocity)(raTaggedComponent* t);
     float (*external_torque)(raTaggedComponent* t);
+    void (*free_fn)(void* ptr);
+    /** Components made with an allocator free `ty` with `free_in_fn` instead of `free_fn` */
+    void (*free_in_fn)(raAllocator* a, void* ptr);
+    /** Copies `ty` into `a`. With `share`, parameters that are not changed while stepping, like
+     * torque maps and gear ratios, are shared with `ty` instead of copied. NULL if not clonable. */
+    void* (*clone_fn)(raAllocator* a, const void* ty, bool share);
+    /** NULL if the component can not be used in a `raPowertrainSchedule` */
+    const raFlatOps* flat_ops;
+} raComponentOps;
+
+struct raTaggedComponent {
+    void* ty;
+    raTaggedComponent* prev;
+    const raComponentOps* ops;
+    /** Set when the callbacks were passed one by one, and are stored with the component */
+    raComponentOps* owned_ops;
+    /** What the component was allocated with */
+    raAllocator* allocator;
     enum raTy comp_ty;
     union raComponentTypes tty;
 };
 
+/** Create a component of type `comp_ty` allocated from `a`. `ops` is not copied and must outlive
+ * the component. */
+raTaggedComponent* ra_tagged_new_with_ops(
+    raAllocator* a, void* ty, enum raTy comp_ty, const raComponentOps* ops);
+
 /** Create a component */
 raTaggedComponent* ra_tagged_new(void* ty,
     float (*inertia_fn)(raTaggedComponent* t, raTaggedComponent* prev, raInertiaDirection d),
@@ -69,6 +132,25 @@ raTaggedComponent* ra_tagged_split_new(void* ty,
     float (*update_angular_velocity)(raTaggedComponent* t),
     float (*external_torque)(raTaggedComponent* t), void (*free_fn)(void* ptr));
 
+/** Same as `ra_tagged_new`, with the component allocated from `a`. `ty` is freed with
+ * `free_fn(a, ty)`. */
+raTaggedComponent* ra_tagged_new_in(raAllocator* a, void* ty,
+    float (*inertia_fn)(raTaggedComponent* t, raTaggedComponent* prev, raInertiaDirection d),
+    float (*angular_velocity)(raTaggedComponent* next),
+    void (*send_torque_fn)(raTaggedComponent* t, raVelocities v, float torque, float dt),
+    void (*receive_torque)(raTaggedComponent* t, float torque, float dt),
+    float (*update_angular_velocity)(raTaggedComponent* t),
+    float (*external_torque)(raTaggedComponent* t), void (*free_fn)(raAllocator* a, void* ptr));
+
+/** Same as `ra_tagged_split_new`, with the component allocated from `a` */
+raTaggedComponent* ra_tagged_split_new_in(raAllocator* a, void* ty,
+    float (*inertia_fn)(raTaggedComponent* t, raTaggedComponent* prev, raInertiaDirection d),
+    float (*angular_velocity)(raTaggedComponent* t),
+    void (*send_torque_fn)(raTaggedComponent* t, raVelocities v, float torque, float dt),
+    void (*receive_torque)(raTaggedComponent* t, float torque, float dt),
+    float (*update_angular_velocity)(raTaggedComponent* t),
+    float (*external_torque)(raTaggedComponent* t), void (*free_fn)(raAllocator* a, void* ptr));
+
 void ra_tagged_component_free(raTaggedComponent* c);
 
 /** Get the inner type. e.g: Clutch, Engine. It must be manually casted to it's real type */
@@ -88,16 +170,108 @@ RaErrorTaggedComponent ra_tagged_add_next_right(raTaggedComponent* t, raTaggedCo
 typedef struct {
     size_t num_subsystems;
     raTaggedComponent** subsystems;
+    raAllocator* allocator;
 } raPowertrainSystem;
 
 raPowertrainSystem ra_powertrain_system_from_varags(size_t num_args, ...);
 raPowertrainSystem ra_powertrain_system_new(size_t max_subsystems);
+raPowertrainSystem ra_powertrain_system_new_in(raAllocator* a, size_t max_subsystems);
 void ra_powertrain_system_free(raPowertrainSystem o);
+/** Copies every component of `sys` and their state into `a` in one pass, linking the copies the
+ * same way without checking for cycles again. With `share`, the clones share their parameters with
+ * the components of `sys`, which must then outlive them. Nothing is allocated on failure. */
+RaErrorTaggedComponent ra_powertrain_system_clone(
+    raPowertrainSystem sys, raAllocator* a, bool share, raPowertrainSystem* clone);
 
 #define RA_POWERTRAIN_SYSTEM(...)                                                                  \
     ra_powertrain_system_from_varags(                                                              \
         sizeof((raTaggedComponent*[]) { __VA_ARGS__ }) / sizeof(raTaggedComponent*), __VA_ARGS__)
 
+typedef struct {
+    raTaggedComponent* c;
+    /** SIZE_MAX for the first component of a subsystem */
+    size_t parent;
+    /** Which child of the parent this is */
+    int slot;
+    /** SIZE_MAX for missing children */
+    size_t children[2];
+    /** One past the last node reachable from this one. Nodes are sorted depth first, so
+     * everything reachable from a node directly follows it. */
+    size_t end;
+} raScheduleNode;
+
+typedef struct {
+    size_t end;
+    size_t node;
+    float torque;
+} raScheduleReceive;
+
+/** A `raPowertrainSystem` sorted into a flat array of nodes. The per step passes are loops over the
+ * array instead of recursive calls through the components, and give exactly the same results. The
+ * schedule does not own the components, and must be compiled again if they are relinked. */
+struct raPowertrainSchedule {
+    size_t num_nodes;
+    raScheduleNode* nodes;
+    size_t num_roots;
+    /** The first node of each subsystem, in the order of the system */
+    size_t* roots;
+
+    float* values[raNumQueries];
+    bool* needed[raNumQueries];
+    bool* expand[raNumQueries];
+    /** Angular velocities and external torques only change once the nodes below have been sent
+     * to, so during a send they are computed once per node. A value is valid when its stamp equals
+     * `send_count`. Outside of a send nothing is reused. */
+    unsigned* stamp[raNumQueries];
+    unsigned send_count;
+    bool sending;
+    float* torque;
+    bool* reached;
+    size_t* path;
+    /** Receiving torque is deferred until everything after the sending node has been sent to,
+     * which is when the recursive version gets to it */
+    raScheduleReceive* receives;
+    size_t num_receives;
+    size_t current;
+    float dt;
+
+    /** Inertias only change with the gear, clutch and differential state, so they are cached
+     * between steps. An entry is valid when its stamp equals `inertia_generation`. */
+    unsigned inertia_generation;
+    int* inertia_keys;
+    /** Three per node, for asking from the node itself and from each child */
+    float* inertia_prev;
+    unsigned* inertia_prev_stamp;
+    float* inertia_next;
+    unsigned* inertia_next_stamp;
+
+    /** What the arrays are allocated with */
+    raAllocator* allocator;
+};
+
+/** Allocates the schedule from `a`, so it can live in the same arena as the components */
+RaErrorTaggedComponent ra_powertrain_schedule_compile(
+    raPowertrainSystem sys, raAllocator* a, raPowertrainSchedule* schedule);
+void ra_powertrain_schedule_free(raPowertrainSchedule* s);
+/** Same as `ra_tagged_send_torque` on the first component of subsystem `subsystem` */
+void ra_powertrain_schedule_send_torque(
+    raPowertrainSchedule* s, size_t subsystem, float torque, raVelocities v, float dt);
+/** Same as `ra_tagged_update_angular_velocity` on every subsystem */
+void ra_powertrain_schedule_update_angular_velocity(raPowertrainSchedule* s);
+
+/** Helpers for `raFlatOps`. Missing nodes (SIZE_MAX) answer 0.0 like NULL components do. */
+float ra_powertrain_schedule_query(raPowertrainSchedule* s, size_t node, raQuery q);
+/** Same as `ra_tagged_inertia(node, from, raInertiaDirectionPrev)` where `from` is a child slot
+ * or -1 for the node itself */
+float ra_powertrain_schedule_inertia_prev(raPowertrainSchedule* s, size_t node, int from);
+void ra_powertrain_schedule_pass_torque(
+    raPowertrainSchedule* s, size_t node, int slot, float torque);
+/** Sends torque back up to `node` once everything after the current node has been sent to */
+void ra_powertrain_schedule_receive_torque(raPowertrainSchedule* s, size_t node, float torque);
+/** Drops the cached inertias. Changes covered by `inertia_key` are picked up at the start of each
+ * send, this is for state that changes in the middle of one, or for changing inertias directly. */
+void ra_powertrain_schedule_invalidate_inertia(raPowertrainSchedule* s);
+
 float ra_tagged_inertia(raTaggedComponent* t, raTaggedComponent* prev, raInertiaDirection d);
 float ra_tagged_angular_velocity(raTaggedComponent* t);
 void ra_tagged_send_torque(raTaggedComponent* t, float torque, raVelocities v, float dt);
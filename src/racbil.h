@@ -5,13 +5,19 @@
 extern "C" {
 #endif
 
+#include "alloc.h"
 #include "assists.h"
 #include "body.h"
 #include "brake.h"
 #include "common.h"
+#include "executor.h"
+#include "fleet.h"
 #include "powertrain.h"
 #include "powertrainabs.h"
+#include "scenario.h"
+#include "telemetry.h"
 #include "tiremodel.h"
+#include "vehicle.h"
 #include "wheel.h"
 
 #ifdef __cplusplus
@@ -0,0 +1,304 @@
+#include "scenario.h"
+#include "alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* channel_names[RA_NUM_CHANNELS] = { "throttle", "brake", "clutch", "steering" };
+static const char* quantity_names[] = { "time", "stage_time", "speed", "rpm", "gear" };
+
+static const char* skip_space(const char* p)
+{
+    while (*p == ' ' || *p == '\t' || *p == '\r') {
+        p++;
+    }
+    return p;
+}
+
+static bool at_line_end(const char* p)
+{
+    p = skip_space(p);
+    return *p == '\0' || *p == '\n' || *p == '#';
+}
+
+static const char* next_line(const char* p)
+{
+    while (*p != '\0' && *p != '\n') {
+        p++;
+    }
+    return *p == '\n' ? p + 1 : p;
+}
+
+static size_t word_len(const char* p)
+{
+    size_t len = 0;
+    while (p[len] != '\0' && p[len] != '#' && p[len] != ' ' && p[len] != '\t' && p[len] != '\r'
+        && p[len] != '\n') {
+        len++;
+    }
+    return len;
+}
+
+/** Index of the word at `p` in `names`, or -1 */
+static int find_word(const char* p, size_t len, const char** names, int num_names)
+{
+    for (int i = 0; i < num_names; i++) {
+        if (strlen(names[i]) == len && strncmp(p, names[i], len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/** Parses the number at `p` and moves past it, or returns false if it is not a whole word */
+static bool parse_number(const char** p, float* value)
+{
+    const char* start = skip_space(*p);
+    char* end;
+    *value = strtof(start, &end);
+    if (end == start || (size_t)(end - start) != word_len(start)) {
+        return false;
+    }
+
+    *p = end;
+    return true;
+}
+
+static bool parse_condition(const char* p, raCondition* condition)
+{
+    p = skip_space(p);
+    size_t len = word_len(p);
+    int quantity = find_word(p, len, quantity_names, sizeof quantity_names / sizeof(char*));
+    if (quantity < 0) {
+        return false;
+    }
+
+    p = skip_space(p + len);
+    len = word_len(p);
+    if (len != 2 || (strncmp(p, ">=", 2) != 0 && strncmp(p, "<=", 2) != 0)) {
+        return false;
+    }
+
+    condition->quantity = (raQuantity)quantity;
+    condition->at_least = p[0] == '>';
+    p += len;
+    return parse_number(&p, &condition->value) && at_line_end(p);
+}
+
+static bool parse_keys(const char* p, raScenario* s, raStage* stage, raChannel channel)
+{
+    // A channel is only given once per stage
+    if (stage->key_begin[channel] != stage->key_end[channel]) {
+        return false;
+    }
+
+    size_t begin = s->num_keys;
+    while (!at_line_end(p)) {
+        float time;
+        float value;
+        if (!parse_number(&p, &time) || !parse_number(&p, &value) || time < 0.0f
+            || (s->num_keys > begin && time <= s->key_times[s->num_keys - 1])) {
+            return false;
+        }
+
+        s->key_times[s->num_keys] = time;
+        s->key_values[s->num_keys] = value;
+        s->num_keys++;
+    }
+
+    stage->key_begin[channel] = (uint32_t)begin;
+    stage->key_end[channel] = (uint32_t)s->num_keys;
+    return s->num_keys > begin;
+}
+
+/** Parses the line at `p` into the last stage of `s` */
+static bool parse_line(const char* p, raScenario* s)
+{
+    p = skip_space(p);
+    size_t len = word_len(p);
+    if (len == 5 && strncmp(p, "stage", 5) == 0) {
+        raStage* stage = &s->stages[s->num_stages++];
+        *stage = (raStage) {
+            .condition_begin = (uint32_t)s->num_conditions,
+            .condition_end = (uint32_t)s->num_conditions,
+        };
+        return at_line_end(p + len);
+    }
+
+    if (s->num_stages == 0) {
+        return false;
+    }
+
+    raStage* stage = &s->stages[s->num_stages - 1];
+    if (len == 5 && strncmp(p, "until", 5) == 0) {
+        stage->condition_end++;
+        return parse_condition(p + len, &s->conditions[s->num_conditions++]);
+    }
+
+    int channel = find_word(p, len, channel_names, RA_NUM_CHANNELS);
+    return channel >= 0 && parse_keys(p + len, s, stage, (raChannel)channel);
+}
+
+RaErrorScenario ra_scenario_parse(raScenario* s, const char* text, size_t* line)
+{
+    // Counted first, so every array is allocated once. Keyframes take two numbers each.
+    size_t num_stages = 0;
+    size_t num_conditions = 0;
+    size_t num_words = 0;
+    for (const char* p = text; *p != '\0'; p = next_line(p)) {
+        const char* word = skip_space(p);
+        size_t len = word_len(word);
+        if (len == 5 && strncmp(word, "stage", 5) == 0) {
+            num_stages++;
+        } else if (len == 5 && strncmp(word, "until", 5) == 0) {
+            num_conditions++;
+        } else {
+            for (; !at_line_end(word); word = skip_space(word + word_len(word))) {
+                num_words++;
+            }
+        }
+    }
+
+    *s = (raScenario) {
+        .num_stages = 0,
+        .stages = ra_alloc(&ra_heap_allocator, num_stages * sizeof(raStage)),
+        .key_times = ra_alloc(&ra_heap_allocator, num_words / 2 * sizeof(float)),
+        .key_values = ra_alloc(&ra_heap_allocator, num_words / 2 * sizeof(float)),
+        .num_keys = 0,
+        .conditions = ra_alloc(&ra_heap_allocator, num_conditions * sizeof(raCondition)),
+        .num_conditions = 0,
+    };
+
+    size_t line_number = 1;
+    for (const char* p = text; *p != '\0'; p = next_line(p), line_number++) {
+        if (!at_line_end(p) && !parse_line(p, s)) {
+            if (line != NULL) {
+                *line = line_number;
+            }
+            ra_scenario_free(s);
+            return RaErrorScenarioSyntax;
+        }
+    }
+
+    if (s->num_stages == 0) {
+        ra_scenario_free(s);
+        return RaErrorScenarioEmpty;
+    }
+
+    return 0;
+}
+
+RaErrorScenario ra_scenario_load(raScenario* s, const char* path, size_t* line)
+{
+    char* text = ra_read_file(&ra_heap_allocator, path);
+    if (text == NULL) {
+        return RaErrorScenarioIo;
+    }
+
+    RaErrorScenario err = ra_scenario_parse(s, text, line);
+    ra_free(&ra_heap_allocator, text);
+    return err;
+}
+
+void ra_scenario_free(raScenario* s)
+{
+    ra_free(&ra_heap_allocator, s->stages);
+    ra_free(&ra_heap_allocator, s->key_times);
+    ra_free(&ra_heap_allocator, s->key_values);
+    ra_free(&ra_heap_allocator, s->conditions);
+}
+
+static void enter_stage(const raScenario* s, raScenarioCursor* c, size_t stage)
+{
+    c->stage = stage;
+    c->stage_start = c->time;
+    if (stage < s->num_stages) {
+        for (int ch = 0; ch < RA_NUM_CHANNELS; ch++) {
+            c->keys[ch] = s->stages[stage].key_begin[ch];
+        }
+    }
+}
+
+raScenarioCursor ra_scenario_cursor_new(const raScenario* s)
+{
+    raScenarioCursor c = { .time = 0.0f };
+    for (int ch = 0; ch < RA_NUM_CHANNELS; ch++) {
+        c.values[ch] = 0.0f;
+    }
+    enter_stage(s, &c, 0);
+    return c;
+}
+
+static float quantity(const raScenarioCursor* c, const raVehicle* v, raQuantity q)
+{
+    switch (q) {
+    case raQuantityTime:
+        return c->time;
+    case raQuantityStageTime:
+        return c->time - c->stage_start;
+    case raQuantitySpeed:
+        return v->velocity.x;
+    case raQuantityRpm:
+        return rads_to_rpm(v->engine->angular_velocity);
+    case raQuantityGear:
+        return (float)v->gearbox->curr_gear;
+    }
+
+    return 0.0f;
+}
+
+static bool stage_ends(const raScenario* s, const raScenarioCursor* c, const raVehicle* v)
+{
+    const raStage* stage = &s->stages[c->stage];
+    for (uint32_t i = stage->condition_begin; i < stage->condition_end; i++) {
+        const raCondition* condition = &s->conditions[i];
+        float q = quantity(c, v, condition->quantity);
+        if (condition->at_least ? q >= condition->value : q <= condition->value) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ra_scenario_next(
+    const raScenario* s, raScenarioCursor* c, const raVehicle* v, float dt, raInputs* in)
+{
+    while (c->stage < s->num_stages && stage_ends(s, c, v)) {
+        enter_stage(s, c, c->stage + 1);
+    }
+    if (c->stage >= s->num_stages) {
+        return false;
+    }
+
+    const raStage* stage = &s->stages[c->stage];
+    float t = c->time - c->stage_start;
+    for (int ch = 0; ch < RA_NUM_CHANNELS; ch++) {
+        uint32_t end = stage->key_end[ch];
+        if (stage->key_begin[ch] == end) {
+            continue;
+        }
+
+        // Time only moves forward, so this is usually one comparison
+        uint32_t k = c->keys[ch];
+        while (k + 1 < end && s->key_times[k + 1] <= t) {
+            k++;
+        }
+        c->keys[ch] = k;
+
+        if (k + 1 == end || t <= s->key_times[k]) {
+            c->values[ch] = s->key_values[k];
+        } else {
+            float f = (t - s->key_times[k]) / (s->key_times[k + 1] - s->key_times[k]);
+            c->values[ch] = s->key_values[k] + (s->key_values[k + 1] - s->key_values[k]) * f;
+        }
+    }
+
+    *in = (raInputs) {
+        .throttle = c->values[raChannelThrottle],
+        .brake = c->values[raChannelBrake],
+        .clutch = c->values[raChannelClutch],
+        .steering = c->values[raChannelSteering],
+    };
+    c->time += dt;
+    return true;
+}
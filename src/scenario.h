@@ -0,0 +1,111 @@
+#ifndef RA_SCENARIO_H
+#define RA_SCENARIO_H
+#include "common.h"
+#include "vehicle.h"
+#include <stdint.h>
+
+/**
+ * Driver inputs read from a text file, one statement per line and `#` starting a comment:
+ *
+ * | statement                        | meaning                                                   |
+ * |----------------------------------|-----------------------------------------------------------|
+ * | stage                            | starts the next stage, the first line must start one       |
+ * | <channel> <time> <value> ...     | keyframes of a channel, in seconds since the stage began  |
+ * | until <quantity> <op> <value>    | ends the stage when it holds, any of several              |
+ *
+ * The channels are `throttle`, `brake`, `clutch` and `steering`, the fields of `raInputs`. Between
+ * keyframes a channel is interpolated linearly, and before the first and after the last it holds
+ * the value of the nearest one. A channel without keyframes in a stage holds its value from the
+ * previous stage, or 0.0 in the first.
+ *
+ * The quantities are `time` since the scenario began, `stage_time`, `speed` in m/s, `rpm` of the
+ * engine and `gear`, compared with `>=` or `<=`. The scenario is over when the last stage ends. A
+ * last stage without conditions never ends.
+ *
+ *     # Launch, then brake to a stop
+ *     stage
+ *     throttle 0 1
+ *     clutch 0 1 3.3 0
+ *     until speed >= 16
+ *     stage
+ *     brake 0 1
+ *     until speed <= 0.05
+ */
+
+typedef enum {
+    raChannelThrottle,
+    raChannelBrake,
+    raChannelClutch,
+    raChannelSteering,
+    RA_NUM_CHANNELS,
+} raChannel;
+
+typedef enum {
+    raQuantityTime,
+    raQuantityStageTime,
+    raQuantitySpeed,
+    raQuantityRpm,
+    raQuantityGear,
+} raQuantity;
+
+typedef enum {
+    /**Could not read the file*/
+    RaErrorScenarioIo = -1,
+    /**A line is not a statement, or keyframe times do not increase*/
+    RaErrorScenarioSyntax = -2,
+    /**There is no stage*/
+    RaErrorScenarioEmpty = -3,
+} RaErrorScenario;
+
+typedef struct {
+    raQuantity quantity;
+    /** `>=` when true, `<=` when false */
+    bool at_least;
+    float value;
+} raCondition;
+
+typedef struct {
+    /** Keyframes of every channel in `raScenario.key_times`, empty when the channel holds */
+    uint32_t key_begin[RA_NUM_CHANNELS];
+    uint32_t key_end[RA_NUM_CHANNELS];
+    uint32_t condition_begin;
+    uint32_t condition_end;
+} raStage;
+
+/** A parsed scenario, with the keyframes of every stage and channel in two flat arrays */
+typedef struct {
+    size_t num_stages;
+    raStage* stages;
+    float* key_times;
+    float* key_values;
+    size_t num_keys;
+    raCondition* conditions;
+    size_t num_conditions;
+} raScenario;
+
+/** Where a vehicle is in a scenario. Keyframes are only searched forward from the last ones, so
+ * reading the inputs takes constant time per step. */
+typedef struct {
+    size_t stage;
+    float time;
+    float stage_start;
+    /** Per channel, the keyframe at or before the stage time */
+    uint32_t keys[RA_NUM_CHANNELS];
+    /** Per channel, the last value, held by stages without keyframes for it */
+    float values[RA_NUM_CHANNELS];
+} raScenarioCursor;
+
+/** On `RaErrorScenarioSyntax` `line` is set to the line, starting at 1, if not NULL */
+RaErrorScenario ra_scenario_parse(raScenario* s, const char* text, size_t* line);
+/** `ra_scenario_parse` of the contents of `path` */
+RaErrorScenario ra_scenario_load(raScenario* s, const char* path, size_t* line);
+void ra_scenario_free(raScenario* s);
+
+raScenarioCursor ra_scenario_cursor_new(const raScenario* s);
+/** Moves past the stages that `v` ends, and writes the inputs at the time of the cursor to `in`.
+ * Then moves the cursor `dt` forward. Returns false, and writes nothing, when the scenario is
+ * over. Call it once before every step of `v`. */
+bool ra_scenario_next(
+    const raScenario* s, raScenarioCursor* c, const raVehicle* v, float dt, raInputs* in);
+
+#endif /* RA_SCENARIO_H */
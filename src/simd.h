@@ -0,0 +1,34 @@
+#ifndef RA_SIMD_H
+#define RA_SIMD_H
+#include <stdbool.h>
+
+/** Internal helpers for the vectorized kernels. SSE2 is always available on x86-64, AVX2 kernels
+ * are compiled for the target separately and only used when the cpu supports it. */
+#if defined(__GNUC__) && defined(__x86_64__)
+#define RA_SIMD_X86
+#include <immintrin.h>
+
+#define RA_TARGET_AVX2 __attribute__((target("avx2")))
+
+static inline bool ra_simd_has_avx2(void) { return __builtin_cpu_supports("avx2"); }
+
+/** Lanes of `a` where `mask` is set, lanes of `b` elsewhere */
+static inline __m128 ra_simd_select(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/** Applies a scalar function to each lane, for libm functions that have no vector version */
+static inline __m128 ra_simd_map(float (*f)(float), __m128 x)
+{
+    float v[4];
+    _mm_storeu_ps(v, x);
+    for (int l = 0; l < 4; l++) {
+        v[l] = f(v[l]);
+    }
+
+    return _mm_loadu_ps(v);
+}
+#endif
+
+#endif /* RA_SIMD_H */
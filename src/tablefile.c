@@ -0,0 +1,165 @@
+#define _POSIX_C_SOURCE 200809L
+#include "tablefile.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define HEADER_LEN 24
+#define FLAG_X_UNIFORM 1u
+#define FLAG_Y_UNIFORM 2u
+
+static const char magic[4] = { 'R', 'A', 'T', 'B' };
+
+static void put_u32(unsigned char* b, uint32_t v)
+{
+    b[0] = (unsigned char)(v & 0xff);
+    b[1] = (unsigned char)((v >> 8) & 0xff);
+    b[2] = (unsigned char)((v >> 16) & 0xff);
+    b[3] = (unsigned char)((v >> 24) & 0xff);
+}
+
+static uint32_t get_u32(const unsigned char* b)
+{
+    return (uint32_t)b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16 | (uint32_t)b[3] << 24;
+}
+
+static bool write_floats(FILE* fs, const float* v, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        uint32_t bits;
+        memcpy(&bits, &v[i], sizeof bits);
+        unsigned char b[4];
+        put_u32(b, bits);
+        if (fwrite(b, sizeof b, 1, fs) != 1) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+RaErrorTableFile table_file_write(const Table* table, const char* path)
+{
+    unsigned char header[HEADER_LEN];
+    memcpy(header, magic, sizeof magic);
+    put_u32(header + 4, RA_TABLE_FILE_VERSION);
+    put_u32(header + 8, (uint32_t)table->x_capacity);
+    put_u32(header + 12, (uint32_t)table->y_capacity);
+    put_u32(header + 16,
+        (table->x_uniform ? FLAG_X_UNIFORM : 0u) | (table->y_uniform ? FLAG_Y_UNIFORM : 0u));
+    put_u32(header + 20, 0);
+
+    FILE* fs = fopen(path, "wb");
+    if (fs == NULL) {
+        return RaErrorTableFileIo;
+    }
+
+    bool ok = fwrite(header, sizeof header, 1, fs) == 1
+        && write_floats(fs, table->x, table->x_capacity)
+        && write_floats(fs, table->y, table->y_capacity)
+        && write_floats(fs, table->z, table->x_capacity * table->y_capacity);
+
+    if (fclose(fs) != 0 || !ok) {
+        return RaErrorTableFileIo;
+    }
+
+    return 0;
+}
+
+static bool is_little_endian(void)
+{
+    uint32_t one = 1;
+    unsigned char b;
+    memcpy(&b, &one, 1);
+    return b == 1;
+}
+
+static float uniform_inv_step(const float* elements, size_t num_elements)
+{
+    // Same as table_uniform_with_capacity
+    return 1.0f / ((elements[num_elements - 1] - elements[0]) / (float)(num_elements - 1));
+}
+
+RaErrorTableFile table_file_map(TableMapping* mapping, const char* path)
+{
+    if (!is_little_endian()) {
+        return RaErrorTableFileEndian;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return RaErrorTableFileIo;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return RaErrorTableFileIo;
+    }
+
+    size_t len = (size_t)st.st_size;
+    if (len < HEADER_LEN) {
+        close(fd);
+        return RaErrorTableFileFormat;
+    }
+
+    void* addr = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return RaErrorTableFileIo;
+    }
+
+    const unsigned char* header = addr;
+    RaErrorTableFile err = 0;
+    uint32_t nx = get_u32(header + 8);
+    uint32_t ny = get_u32(header + 12);
+    uint32_t flags = get_u32(header + 16);
+
+    if (memcmp(header, magic, sizeof magic) != 0) {
+        err = RaErrorTableFileFormat;
+    } else if (get_u32(header + 4) != RA_TABLE_FILE_VERSION) {
+        err = RaErrorTableFileVersion;
+    } else if (nx < 2 || ny < 2
+        || (len - HEADER_LEN) / sizeof(float) < (size_t)nx + ny + (size_t)nx * ny) {
+        err = RaErrorTableFileFormat;
+    }
+
+    if (err != 0) {
+        munmap(addr, len);
+        return err;
+    }
+
+    float* x = (float*)(void*)((unsigned char*)addr + HEADER_LEN);
+    float* y = x + nx;
+    Table t = {
+        .x_capacity = nx,
+        .y_capacity = ny,
+        .x = x,
+        .y = y,
+        .z = y + ny,
+        .x_uniform = (flags & FLAG_X_UNIFORM) != 0,
+        .y_uniform = (flags & FLAG_Y_UNIFORM) != 0,
+        .owned = false,
+    };
+    t.x_inv_step = t.x_uniform ? uniform_inv_step(t.x, nx) : 0.0f;
+    t.y_inv_step = t.y_uniform ? uniform_inv_step(t.y, ny) : 0.0f;
+
+    *mapping = (TableMapping) { .addr = addr, .len = len, .table = t };
+    return 0;
+}
+
+void table_file_unmap(TableMapping* mapping)
+{
+    if (mapping->addr != NULL) {
+        munmap(mapping->addr, mapping->len);
+    }
+
+    mapping->addr = NULL;
+    mapping->len = 0;
+    mapping->table = (Table) { .x = NULL };
+}
@@ -0,0 +1,46 @@
+#ifndef RA_TABLEFILE_H
+#define RA_TABLEFILE_H
+#include "common.h"
+
+/**
+ * Binary table files. Everything is little-endian:
+ *
+ * | offset | type          | contents                                   |
+ * |--------|---------------|--------------------------------------------|
+ * | 0      | char[4]       | "RATB"                                     |
+ * | 4      | uint32        | version, currently 1                       |
+ * | 8      | uint32        | number of x breakpoints                    |
+ * | 12     | uint32        | number of y breakpoints                    |
+ * | 16     | uint32        | flags, bit 0: x uniform, bit 1: y uniform  |
+ * | 20     | uint32        | reserved, 0                                |
+ * | 24     | float32[]     | x, then y, then z in row-major order       |
+ *
+ * The layout matches the in-memory layout of a Table, so a mapped file is used as is.
+ */
+#define RA_TABLE_FILE_VERSION 1
+
+typedef enum {
+    /**Could not open, read, write or map the file*/
+    RaErrorTableFileIo = -1,
+    /**Not a table file, or the file is truncated*/
+    RaErrorTableFileFormat = -2,
+    /**Not written in `RA_TABLE_FILE_VERSION`*/
+    RaErrorTableFileVersion = -3,
+    /**Floats can not be used in place on this platform*/
+    RaErrorTableFileEndian = -4,
+} RaErrorTableFile;
+
+/** A table file mapped into memory */
+typedef struct {
+    void* addr;
+    size_t len;
+    /** A read-only view, it points directly into the mapping. Valid until `table_file_unmap`. */
+    Table table;
+} TableMapping;
+
+RaErrorTableFile table_file_write(const Table* table, const char* path);
+/** Maps `path` read-only. Nothing is copied and processes mapping the same file share its pages */
+RaErrorTableFile table_file_map(TableMapping* mapping, const char* path);
+void table_file_unmap(TableMapping* mapping);
+
+#endif /* RA_TABLEFILE_H */
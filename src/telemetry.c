@@ -0,0 +1,158 @@
+#include "telemetry.h"
+#include "alloc.h"
+#include <stdint.h>
+#include <string.h>
+#include <zlib.h>
+
+static bool is_little_endian(void)
+{
+    uint32_t one = 1;
+    unsigned char b;
+    memcpy(&b, &one, 1);
+    return b == 1;
+}
+
+static bool write_all(gzFile file, const void* data, size_t len)
+{
+    return len == 0 || gzwrite(file, data, (unsigned)len) == (int)len;
+}
+
+static bool write_u32(gzFile file, uint32_t v)
+{
+    return write_all(file, &v, sizeof v);
+}
+
+static bool write_chunk(raTelemetry* t, const float* chunk, size_t rows)
+{
+    bool ok = write_u32(t->file, (uint32_t)rows);
+    for (size_t ch = 0; ok && ch < t->num_channels; ch++) {
+        ok = write_all(t->file, chunk + ch * RA_TELEMETRY_CHUNK_ROWS, rows * sizeof(float));
+    }
+    return ok;
+}
+
+static int writer_main(void* arg)
+{
+    raTelemetry* t = arg;
+    mtx_lock(&t->lock);
+    for (;;) {
+        while (t->written_rows == 0 && !t->closing) {
+            cnd_wait(&t->changed, &t->lock);
+        }
+        if (t->written_rows == 0) {
+            // Closing, and everything has been written
+            break;
+        }
+
+        const float* chunk = t->chunks[t->written];
+        size_t rows = t->written_rows;
+        mtx_unlock(&t->lock);
+        bool ok = write_chunk(t, chunk, rows);
+        mtx_lock(&t->lock);
+
+        t->failed = t->failed || !ok;
+        t->written_rows = 0;
+        cnd_broadcast(&t->changed);
+    }
+    mtx_unlock(&t->lock);
+    return 0;
+}
+
+RaErrorTelemetry ra_telemetry_open(
+    raTelemetry* t, const char* path, const char* const* channel_names, size_t num_channels)
+{
+    if (!is_little_endian()) {
+        return RaErrorTelemetryEndian;
+    }
+
+    gzFile file = gzopen(path, "wb");
+    if (file == NULL) {
+        return RaErrorTelemetryIo;
+    }
+
+    bool ok = write_all(file, "RATL", 4) && write_u32(file, RA_TELEMETRY_VERSION)
+        && write_u32(file, (uint32_t)num_channels);
+    for (size_t ch = 0; ok && ch < num_channels; ch++) {
+        size_t len = strlen(channel_names[ch]);
+        ok = write_u32(file, (uint32_t)len) && write_all(file, channel_names[ch], len);
+    }
+
+    size_t chunk_size = num_channels * RA_TELEMETRY_CHUNK_ROWS * sizeof(float);
+    *t = (raTelemetry) {
+        .num_channels = num_channels,
+        .file = file,
+        .chunks = {
+            ra_alloc(&ra_heap_allocator, chunk_size),
+            ra_alloc(&ra_heap_allocator, chunk_size),
+        },
+        .filling = 0,
+        .rows = 0,
+        .written_rows = 0,
+        .written = 0,
+        .closing = false,
+        .failed = false,
+    };
+    mtx_init(&t->lock, mtx_plain);
+    cnd_init(&t->changed);
+
+    if (!ok || thrd_create(&t->writer, writer_main, t) != thrd_success) {
+        cnd_destroy(&t->changed);
+        mtx_destroy(&t->lock);
+        ra_free(&ra_heap_allocator, t->chunks[0]);
+        ra_free(&ra_heap_allocator, t->chunks[1]);
+        gzclose(file);
+        return RaErrorTelemetryIo;
+    }
+
+    return 0;
+}
+
+/** Hands the chunk being recorded to the writer, once it is done with the other one */
+static void submit(raTelemetry* t)
+{
+    mtx_lock(&t->lock);
+    while (t->written_rows > 0) {
+        cnd_wait(&t->changed, &t->lock);
+    }
+    t->written = t->filling;
+    t->written_rows = t->rows;
+    cnd_broadcast(&t->changed);
+    mtx_unlock(&t->lock);
+
+    t->filling = 1 - t->filling;
+    t->rows = 0;
+}
+
+void ra_telemetry_record(raTelemetry* t, const float* values)
+{
+    float* chunk = t->chunks[t->filling];
+    for (size_t ch = 0; ch < t->num_channels; ch++) {
+        chunk[ch * RA_TELEMETRY_CHUNK_ROWS + t->rows] = values[ch];
+    }
+
+    t->rows++;
+    if (t->rows == RA_TELEMETRY_CHUNK_ROWS) {
+        submit(t);
+    }
+}
+
+RaErrorTelemetry ra_telemetry_close(raTelemetry* t)
+{
+    if (t->rows > 0) {
+        submit(t);
+    }
+
+    mtx_lock(&t->lock);
+    t->closing = true;
+    cnd_broadcast(&t->changed);
+    mtx_unlock(&t->lock);
+    thrd_join(t->writer, NULL);
+
+    bool closed = gzclose(t->file) == Z_OK;
+    bool failed = t->failed || !closed;
+    cnd_destroy(&t->changed);
+    mtx_destroy(&t->lock);
+    ra_free(&ra_heap_allocator, t->chunks[0]);
+    ra_free(&ra_heap_allocator, t->chunks[1]);
+    return failed ? RaErrorTelemetryIo : 0;
+}
@@ -0,0 +1,69 @@
+#ifndef RA_TELEMETRY_H
+#define RA_TELEMETRY_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <threads.h>
+
+/**
+ * Gzip compressed telemetry streams. Everything is little-endian, and the uncompressed stream is:
+ *
+ * | type          | contents                                                      |
+ * |---------------|---------------------------------------------------------------|
+ * | char[4]       | "RATL"                                                        |
+ * | uint32        | version, currently 1                                          |
+ * | uint32        | number of channels                                            |
+ * |               | for every channel:                                            |
+ * | uint32        |   length of the name                                          |
+ * | char[]        |   name, not terminated                                        |
+ * |               | chunks until the end of the stream:                           |
+ * | uint32        |   number of rows, at most `RA_TELEMETRY_CHUNK_ROWS`           |
+ * | float32[]     |   the rows of every channel, one channel after the other      |
+ */
+#define RA_TELEMETRY_VERSION 1
+/** Rows of a chunk */
+#define RA_TELEMETRY_CHUNK_ROWS 1024
+
+typedef enum {
+    /**Could not open or write the file*/
+    RaErrorTelemetryIo = -1,
+    /**Floats can not be written as is on this platform*/
+    RaErrorTelemetryEndian = -2,
+} RaErrorTelemetry;
+
+/** Records rows of floats into a telemetry file with constant memory. Rows are kept in one of two
+ * preallocated chunks. When one is full, a writer thread compresses and writes it while the other
+ * one fills up. */
+typedef struct {
+    size_t num_channels;
+    /** The gzFile */
+    void* file;
+    /** Channel after channel, `RA_TELEMETRY_CHUNK_ROWS` floats each */
+    float* chunks[2];
+    /** Chunk being recorded into */
+    int filling;
+    size_t rows;
+
+    thrd_t writer;
+    mtx_t lock;
+    /** Signaled when a chunk is handed to the writer, when the writer is done with it, and on
+     * closing */
+    cnd_t changed;
+    /** Rows of the chunk handed to the writer, 0 if there is none */
+    size_t written_rows;
+    int written;
+    bool closing;
+    /** A write failed, set by the writer */
+    bool failed;
+} raTelemetry;
+
+/** Creates `path` and writes the header. Nothing is left open on failure. */
+RaErrorTelemetry ra_telemetry_open(
+    raTelemetry* t, const char* path, const char* const* channel_names, size_t num_channels);
+/** Appends a row with one value per channel. Only waits if the writer is still busy with the
+ * other chunk when this one fills up. */
+void ra_telemetry_record(raTelemetry* t, const float* values);
+/** Writes the rows left and closes the file. Returns `RaErrorTelemetryIo` if anything could not be
+ * written. */
+RaErrorTelemetry ra_telemetry_close(raTelemetry* t);
+
+#endif /* RA_TELEMETRY_H */
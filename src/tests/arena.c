@@ -0,0 +1,186 @@
+#include "../alloc.h"
+#include "../powertrain.h"
+#include "../powertrainabs.h"
+#include "../wheel.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/** Counts live allocations on top of the heap */
+typedef struct {
+    raAllocator allocator;
+    int live;
+} CountingAllocator;
+
+static void* counting_alloc(raAllocator* a, size_t size)
+{
+    ((CountingAllocator*)a)->live++;
+    return malloc(size);
+}
+
+static void counting_free(raAllocator* a, void* ptr)
+{
+    ((CountingAllocator*)a)->live--;
+    free(ptr);
+}
+
+typedef struct {
+    Engine* engine;
+    Clutch* clutch;
+    Gearbox* gb;
+    Differential* diff;
+    Wheel* wheels[2];
+    raPowertrainSystem sys;
+} Vehicle;
+
+/** Rear wheel drive, everything allocated from `a` */
+static Vehicle vehicle_new_in(raAllocator* a)
+{
+    Vehicle v;
+    Table torque_map = table_with_capacity_in(a, 2, 3);
+    float rpm[3] = { 0.0f, 300.0f, 600.0f };
+    for (size_t j = 0; j < 3; j++) {
+        torque_map.y[j] = rpm[j];
+        table_set(&torque_map, 0, j, -20.0f - 0.05f * rpm[j]);
+        table_set(&torque_map, 1, j, 150.0f - 0.1f * rpm[j]);
+    }
+    torque_map.x[0] = 0.0f;
+    torque_map.x[1] = 1.0f;
+    v.engine = engine_new_in(a, 0.5f, torque_map);
+    v.engine->angular_velocity = 100.0f;
+
+    float clutch_normal_force;
+    v.clutch = clutch_with_torque_in(a, &clutch_normal_force, 300.0f, 240.0f);
+
+    VecFloat ratios = vec_with_capacity_in(a, 1);
+    VecFloat inertias = vec_with_capacity_in(a, 1);
+    float gear_ratios[3] = { -3.6f, 3.2f, 2.31f };
+    float gear_inertias[3] = { 0.3f, 0.2f, 0.18f };
+    for (int i = 0; i < 3; i++) {
+        // Grows past the initial capacity
+        vec_push_float(&ratios, gear_ratios[i]);
+        vec_push_float(&inertias, gear_inertias[i]);
+    }
+    v.gb = gearbox_new_in(a, ratios, inertias);
+    v.gb->curr_gear = 1;
+
+    v.diff = differential_new_in(a, 3.2f, 0.18f, DiffTypeLocked);
+    for (int i = 0; i < 2; i++) {
+        v.wheels[i] = wheel_new_in(a, 0.6f, 0.344f, (Vector2f) { .x = -1.0f, .y = 0.0f }, 0.1f);
+    }
+
+    raTaggedComponent* engine = ra_tag_engine_in(a, v.engine);
+    raTaggedComponent* clutch = ra_tag_clutch_in(a, v.clutch);
+    raTaggedComponent* gb = ra_tag_gearbox_in(a, v.gb);
+    raTaggedComponent* diff = ra_tag_differential_in(a, v.diff);
+    assert(ra_tagged_add_next(engine, clutch) == 0);
+    assert(ra_tagged_add_next(clutch, gb) == 0);
+    assert(ra_tagged_add_next(gb, diff) == 0);
+    assert(ra_tagged_add_next_left(diff, ra_tag_wheel_in(a, v.wheels[0])) == 0);
+    assert(ra_tagged_add_next_right(diff, ra_tag_wheel_in(a, v.wheels[1])) == 0);
+    ((ClutchTagged*)ra_tagged_component_inner(clutch))->curr_normal_force = clutch_normal_force;
+
+    v.sys = ra_powertrain_system_new_in(a, 1);
+    v.sys.subsystems[0] = engine;
+    return v;
+}
+
+static bool in_arena(const raArena* arena, const void* p)
+{
+    const unsigned char* b = p;
+    return b >= arena->data && b < arena->data + arena->used;
+}
+
+int main(void)
+{
+    raArena arena;
+    ra_arena_init(&arena, 8192);
+    Vehicle v = vehicle_new_in(&arena.allocator);
+
+    // The whole vehicle is in the one block
+    assert(in_arena(&arena, v.engine) && in_arena(&arena, v.engine->torque_map.x));
+    assert(in_arena(&arena, v.engine->curves.inv_dx));
+    assert(in_arena(&arena, v.clutch) && in_arena(&arena, v.diff));
+    assert(in_arena(&arena, v.gb) && in_arena(&arena, v.gb->ratios.elements));
+    assert(in_arena(&arena, v.wheels[0]) && in_arena(&arena, v.wheels[1]));
+    assert(in_arena(&arena, v.sys.subsystems) && in_arena(&arena, v.sys.subsystems[0]));
+    assert(v.gb->ratios.len == 3 && v.gb->ratios.elements[2] == 2.31f);
+
+    // Wheels start on a cache line
+    for (int i = 0; i < 2; i++) {
+        assert((uintptr_t)v.wheels[i] % RA_CACHE_LINE == 0);
+    }
+
+    raPowertrainSchedule schedule;
+    assert(ra_powertrain_schedule_compile(v.sys, &arena.allocator, &schedule) == 0);
+    assert(in_arena(&arena, schedule.nodes) && in_arena(&arena, schedule.stamp[0]));
+    raVelocities vel = { .velocity_cog = { .x = 0.0, .y = 0.0 }, .yaw_velocity_cog = 0.0 };
+
+    // Stepping allocates nothing
+    size_t used = arena.used;
+    size_t num_allocations = arena.num_allocations;
+    for (int step = 0; step < 200; step++) {
+        float torque = engine_torque(v.engine, 0.5f);
+        ra_powertrain_schedule_send_torque(&schedule, 0, torque, vel, 1.0f / 200.0f);
+        ra_powertrain_schedule_update_angular_velocity(&schedule);
+    }
+    assert(arena.used == used && arena.num_allocations == num_allocations);
+    assert(v.wheels[0]->angular_velocity > 0.0f);
+
+    // Freeing single objects is a no-op, and everything goes at once
+    ra_powertrain_schedule_free(&schedule);
+    ra_powertrain_system_free(v.sys);
+    assert(arena.used == used);
+    ra_arena_reset(&arena);
+    assert(arena.used == 0 && arena.num_allocations == 0);
+
+    // Running out of the block is running out of memory
+    assert(arena.allocator.alloc(&arena.allocator, arena.capacity + 1) == NULL);
+    ra_arena_free(&arena);
+
+    // Alignments larger than the block's own are kept
+    raArena aligned;
+    ra_arena_init(&aligned, 1 << 16);
+    for (size_t align = 16; align <= 4096; align *= 2) {
+        ra_alloc(&aligned.allocator, 1);
+        void* p = ra_alloc_aligned(&aligned.allocator, 8, align);
+        assert((uintptr_t)p % align == 0 && in_arena(&aligned, p));
+    }
+
+    // Aligning the arena aligns the next allocation, whatever it asks for
+    ra_alloc(&aligned.allocator, 1);
+    ra_arena_align(&aligned, RA_CACHE_LINE);
+    assert((uintptr_t)ra_alloc(&aligned.allocator, 1) % RA_CACHE_LINE == 0);
+    ra_arena_free(&aligned);
+    raArena small;
+    ra_arena_init(&small, 100);
+    ra_alloc(&small.allocator, 70);
+    ra_arena_align(&small, RA_CACHE_LINE);
+    assert(small.used == small.capacity);
+    ra_arena_free(&small);
+
+    // Objects made with an allocator free everything they allocated through it
+    CountingAllocator counting = {
+        .allocator = { .alloc = counting_alloc, .free = counting_free },
+        .live = 0,
+    };
+    Vehicle h = vehicle_new_in(&counting.allocator);
+    raPowertrainSchedule counted;
+    assert(ra_powertrain_schedule_compile(h.sys, &counting.allocator, &counted) == 0);
+    assert(counting.live > 0);
+
+    // Stepping allocates nothing, also on the heap
+    int live = counting.live;
+    for (int step = 0; step < 200; step++) {
+        ra_powertrain_schedule_send_torque(&counted, 0, engine_torque(h.engine, 0.5f), vel, 0.005f);
+        ra_powertrain_schedule_update_angular_velocity(&counted);
+    }
+    assert(counting.live == live);
+
+    ra_powertrain_schedule_free(&counted);
+    ra_powertrain_system_free(h.sys);
+    assert(counting.live == 0);
+
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include "../powertrain.h"
+#include "../powertrainabs.h"
+#include "../wheel.h"
+#include "test.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    Engine* engine;
+    ClutchTagged* clutch;
+    Gearbox* gb;
+    Wheel* wheels[2];
+} Parts;
+
+/** Finds the parts of a rear wheel drive system, also in clones */
+static Parts parts_of(raPowertrainSystem sys)
+{
+    raTaggedComponent* engine = sys.subsystems[0];
+    raTaggedComponent* clutch = engine->tty.normal.next;
+    raTaggedComponent* gb = clutch->tty.normal.next;
+    raTaggedComponent* diff = gb->tty.normal.next;
+    return (Parts) {
+        .engine = ra_tagged_component_inner(engine),
+        .clutch = ra_tagged_component_inner(clutch),
+        .gb = ra_tagged_component_inner(gb),
+        .wheels = { ra_tagged_component_inner(diff->tty.split.next_left),
+            ra_tagged_component_inner(diff->tty.split.next_right) },
+    };
+}
+
+static raPowertrainSystem vehicle_new(void)
+{
+    Engine* engine = test_engine();
+    engine->angular_velocity = 150.0f;
+    float clutch_normal_force;
+    Clutch* clutch = clutch_with_torque(&clutch_normal_force, 300.0, 240.0);
+    Gearbox* gb = test_gearbox();
+    gb->curr_gear = 1;
+
+    raTaggedComponent* c_engine = ra_tag_engine(engine);
+    raTaggedComponent* c_clutch = ra_tag_clutch(clutch);
+    ((ClutchTagged*)ra_tagged_component_inner(c_clutch))->curr_normal_force = clutch_normal_force;
+    raTaggedComponent* c_gb = ra_tag_gearbox(gb);
+    raTaggedComponent* c_diff = ra_tag_differential(differential_new(3.2, 0.18, DiffTypeOpen));
+    raTaggedComponent* c_left = ra_tag_wheel(wheel_new(0.6, 0.344, vector2f_default(), 0.1));
+    raTaggedComponent* c_right = ra_tag_wheel(wheel_new(0.6, 0.344, vector2f_default(), 0.1));
+
+    assert(ra_tagged_add_next(c_engine, c_clutch) == 0);
+    assert(ra_tagged_add_next(c_clutch, c_gb) == 0);
+    assert(ra_tagged_add_next(c_gb, c_diff) == 0);
+    assert(ra_tagged_add_next_left(c_diff, c_left) == 0);
+    assert(ra_tagged_add_next_right(c_diff, c_right) == 0);
+    return RA_POWERTRAIN_SYSTEM(c_engine);
+}
+
+static bool same(float a, float b) { return memcmp(&a, &b, sizeof a) == 0; }
+
+int main(void)
+{
+    raPowertrainSystem original = vehicle_new();
+
+    // Some state to carry over
+    Parts o = parts_of(original);
+    o.wheels[0]->angular_velocity = 20.0f;
+    o.wheels[1]->reaction_torque = -30.0f;
+    o.gb->curr_gear = 2;
+
+    raPowertrainSystem deep, shared;
+    assert(ra_powertrain_system_clone(original, &ra_heap_allocator, false, &deep) == 0);
+    assert(ra_powertrain_system_clone(original, &ra_heap_allocator, true, &shared) == 0);
+    Parts d = parts_of(deep);
+    Parts s = parts_of(shared);
+
+    // Nothing mutable is shared, parameters only when asked to
+    assert(d.engine != o.engine && d.clutch != o.clutch && d.clutch->c != o.clutch->c);
+    assert(d.wheels[0] != o.wheels[0] && d.wheels[0]->angular_velocity == 20.0f);
+    assert(d.gb->curr_gear == 2 && d.clutch->curr_normal_force == o.clutch->curr_normal_force);
+    assert(d.engine->torque_map.x != o.engine->torque_map.x && d.engine->torque_map.owned);
+    assert(d.gb->ratios.elements != o.gb->ratios.elements);
+    assert(s.engine != o.engine && s.engine->torque_map.x == o.engine->torque_map.x);
+    assert(!s.engine->torque_map.owned && s.gb->ratios.elements == o.gb->ratios.elements);
+    assert(s.engine->curves.inv_dx == o.engine->curves.inv_dx && !s.engine->curves.owned);
+    assert(d.engine->curves.inv_dx != o.engine->curves.inv_dx && d.engine->curves.owned);
+
+    // The callbacks are one table per kind of component
+    assert(shared.subsystems[0]->ops == original.subsystems[0]->ops);
+    assert(deep.subsystems[0]->ops == original.subsystems[0]->ops);
+    assert(shared.subsystems[0]->owned_ops == NULL);
+
+    raPowertrainSystem systems[3] = { original, deep, shared };
+    raPowertrainSchedule schedules[3];
+    for (int i = 0; i < 3; i++) {
+        assert(ra_powertrain_schedule_compile(systems[i], &ra_heap_allocator, &schedules[i]) == 0);
+    }
+
+    // The clones step exactly like the original
+    raVelocities vel = { .velocity_cog = { .x = 5.0, .y = 0.0 }, .yaw_velocity_cog = 0.0 };
+    for (int step = 0; step < 300; step++) {
+        for (int i = 0; i < 3; i++) {
+            Parts p = parts_of(systems[i]);
+            float torque = engine_torque(p.engine, step < 200 ? 0.8f : 0.0f);
+            ra_powertrain_schedule_send_torque(&schedules[i], 0, torque, vel, 1.0f / 200.0f);
+            ra_powertrain_schedule_update_angular_velocity(&schedules[i]);
+        }
+
+        Parts p[3] = { parts_of(original), parts_of(deep), parts_of(shared) };
+        for (int i = 1; i < 3; i++) {
+            assert(same(p[i].engine->angular_velocity, p[0].engine->angular_velocity));
+            assert(p[i].clutch->c->is_locked == p[0].clutch->c->is_locked);
+            for (int w = 0; w < 2; w++) {
+                assert(same(p[i].wheels[w]->angular_velocity, p[0].wheels[w]->angular_velocity));
+            }
+        }
+    }
+
+    for (int i = 0; i < 3; i++) {
+        ra_powertrain_schedule_free(&schedules[i]);
+    }
+
+    // The shared clone goes first, the deep one does not need the original
+    ra_powertrain_system_free(shared);
+    ra_powertrain_system_free(original);
+    assert(parts_of(deep).gb->ratios.elements[1] == 3.2f);
+    ra_powertrain_system_free(deep);
+
+    // Components from outside the library can not be cloned
+    raTaggedComponent* opaque = ra_tagged_new(malloc(1), NULL, NULL, NULL, NULL, NULL, NULL, free);
+    raPowertrainSystem sys = RA_POWERTRAIN_SYSTEM(opaque);
+    raPowertrainSystem clone;
+    assert(ra_powertrain_system_clone(sys, &ra_heap_allocator, false, &clone)
+        == RaErrorTaggedNotClonable);
+    ra_powertrain_system_free(sys);
+
+    return 0;
+}
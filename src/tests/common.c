@@ -1,5 +1,9 @@
 #include "../common.h"
 #include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PATH "test_common.txt"
 
 int main(void)
 {
@@ -13,18 +17,33 @@ int main(void)
     table.y[1] = 0.0;
     table.y[2] = 10.0;
 
-    table.z[0][0] = 20.0;
-    table.z[0][1] = 10.0;
-    table.z[0][2] = 20.0;
+    table_set(&table, 0, 0, 20.0);
+    table_set(&table, 0, 1, 10.0);
+    table_set(&table, 0, 2, 20.0);
 
-    table.z[1][0] = 10.0;
-    table.z[1][1] = 10.0;
-    table.z[1][2] = 40.0;
+    table_set(&table, 1, 0, 10.0);
+    table_set(&table, 1, 1, 10.0);
+    table_set(&table, 1, 2, 40.0);
 
     assert(table_lookup(&table, 1.0, 5.0) == 20.0);
     assert(table_lookup(&table, 1.0, 10.0) == 30.0);
 
     table_free(&table);
 
+    // Files longer than the first buffer are read whole
+    FILE* fs = fopen(PATH, "wb");
+    assert(fs != NULL);
+    for (int i = 0; i < 1000; i++) {
+        fprintf(fs, "line %d\n", i);
+    }
+    long len = ftell(fs);
+    fclose(fs);
+    char* text = ra_read_file(&ra_heap_allocator, PATH);
+    assert(text != NULL && strlen(text) == (size_t)len);
+    assert(strncmp(text, "line 0\nline 1\n", 14) == 0);
+    ra_free(&ra_heap_allocator, text);
+    remove(PATH);
+    assert(ra_read_file(&ra_heap_allocator, PATH) == NULL);
+
     return 0;
 }
@@ -0,0 +1,139 @@
+#include "../executor.h"
+#include "../vehicle.h"
+#include "test.h"
+#include <assert.h>
+
+#define NUM_VEHICLES 150
+#define NUM_STEPS 400
+
+/** Launches with different clutch, throttle and steering, then some shift up and some brake */
+static raInputs inputs(int step, size_t vehicle)
+{
+    float t = (float)step / 200.0f;
+    float k = (float)(vehicle % 11) / 11.0f;
+    bool braking = step > 250 && vehicle % 2 == 0;
+    return (raInputs) {
+        .throttle = braking ? 0.0f : 0.5f + 0.5f * k,
+        .brake = braking ? 0.5f + 0.5f * k : 0.0f,
+        .clutch = fmaxf(0.0f, 1.0f - t * t * (0.2f + k)),
+        .steering = deg_to_rad(30.0f * (k - 0.5f)) * sinf(t * 3.0f),
+    };
+}
+
+static raVehicle* vehicles_new(const raVehicle* v)
+{
+    raVehicle* vehicles = ra_alloc_aligned(
+        &ra_heap_allocator, NUM_VEHICLES * sizeof(raVehicle), RA_CACHE_LINE);
+    for (size_t i = 0; i < NUM_VEHICLES; i++) {
+        assert(ra_vehicle_clone(v, &ra_heap_allocator, &vehicles[i]) == 0);
+    }
+    return vehicles;
+}
+
+static void vehicles_free(raVehicle* vehicles)
+{
+    for (size_t i = 0; i < NUM_VEHICLES; i++) {
+        ra_vehicle_free(&vehicles[i]);
+    }
+    ra_free(&ra_heap_allocator, vehicles);
+}
+
+/** Hashes every vehicle in order on this thread */
+static uint64_t hash_in_order(const raVehicle* vehicles)
+{
+    uint64_t hash = RA_VEHICLE_HASH_INIT;
+    for (size_t i = 0; i < NUM_VEHICLES; i++) {
+        hash = ra_vehicle_hash(&vehicles[i], hash);
+    }
+    return hash;
+}
+
+/** Steps a run on `num_threads` threads and returns the hash of the executor */
+static uint64_t run(const raVehicle* v, size_t num_threads, bool deterministic, uint64_t* in_order)
+{
+    raExecutor e;
+    ra_executor_init(&e, num_threads);
+    assert(e.num_threads == num_threads);
+    ra_executor_set_deterministic(&e, deterministic);
+
+    raVehicle* vehicles = vehicles_new(v);
+    raInputs in[NUM_VEHICLES];
+    for (int step = 0; step < NUM_STEPS; step++) {
+        for (size_t i = 0; i < NUM_VEHICLES; i++) {
+            in[i] = inputs(step, i);
+            if (step == 150 + (int)i % 50) {
+                gearbox_upshift(vehicles[i].gearbox);
+            }
+        }
+        ra_executor_step(&e, vehicles, in, NUM_VEHICLES, 1.0f / 200.0f);
+    }
+
+    uint64_t hash = ra_executor_hash(&e, vehicles, NUM_VEHICLES);
+    *in_order = hash_in_order(vehicles);
+    vehicles_free(vehicles);
+    ra_executor_free(&e);
+    return hash;
+}
+
+int main(void)
+{
+    TireModel model = test_tire_model();
+    raVehicleParams params = test_vehicle_params(&model);
+    raVehicle v;
+    assert(ra_vehicle_init(&v, &params, test_vehicle_parts(&params)) == 0);
+
+    // A single threaded run without the executor
+    raVehicle* vehicles = vehicles_new(&v);
+    for (int step = 0; step < NUM_STEPS; step++) {
+        for (size_t i = 0; i < NUM_VEHICLES; i++) {
+            if (step == 150 + (int)i % 50) {
+                gearbox_upshift(vehicles[i].gearbox);
+            }
+            raInputs in = inputs(step, i);
+            ra_vehicle_step(&vehicles[i], &in, 1.0f / 200.0f);
+        }
+    }
+    uint64_t expected_in_order = hash_in_order(vehicles);
+    vehicles_free(vehicles);
+
+    // The hash sees a single bit
+    raVehicle changed;
+    assert(ra_vehicle_clone(&v, &ra_heap_allocator, &changed) == 0);
+    uint64_t hash = ra_vehicle_hash(&changed, RA_VEHICLE_HASH_INIT);
+    changed.wheels[3]->angle = nextafterf(changed.wheels[3]->angle, 1.0f);
+    assert(ra_vehicle_hash(&changed, RA_VEHICLE_HASH_INIT) != hash);
+    ra_vehicle_free(&changed);
+
+    uint64_t in_order;
+    uint64_t expected = run(&v, 1, true, &in_order);
+    assert(in_order == expected_in_order);
+
+    size_t num_threads[] = { 1, 2, 8, 32 };
+    for (size_t t = 0; t < sizeof num_threads / sizeof num_threads[0]; t++) {
+        // Twice, to see that reruns agree
+        for (int rerun = 0; rerun < 2; rerun++) {
+            assert(run(&v, num_threads[t], true, &in_order) == expected);
+            assert(in_order == expected_in_order);
+        }
+
+        // Stealing changes who steps a vehicle, but not the vehicle
+        run(&v, num_threads[t], false, &in_order);
+        assert(in_order == expected_in_order);
+    }
+
+    // The chunks of deterministic mode only depend on the vehicles
+    raExecutor one;
+    raExecutor many;
+    ra_executor_init(&one, 1);
+    ra_executor_init(&many, 32);
+    ra_executor_set_deterministic(&one, true);
+    ra_executor_set_deterministic(&many, true);
+    for (size_t n = 0; n < 5000; n += 13) {
+        assert(ra_executor_chunk_size(&one, n) == ra_executor_chunk_size(&many, n));
+    }
+    ra_executor_free(&many);
+    ra_executor_free(&one);
+
+    ra_vehicle_free(&v);
+    return 0;
+}
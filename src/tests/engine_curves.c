@@ -0,0 +1,35 @@
+#include "../powertrain.h"
+#include "test.h"
+#include <assert.h>
+#include <math.h>
+
+int main(void)
+{
+    Engine* engine = test_engine();
+
+    for (int rpm = -100; rpm <= 7000; rpm += 7) {
+        engine->angular_velocity = rpm_to_rads((float)rpm);
+
+        assert(engine_min_torque(engine) == engine_torque(engine, 0.0));
+        assert(engine_max_torque(engine) == engine_torque(engine, 1.0));
+
+        for (int i = -2; i <= 12; i++) {
+            float throttle = (float)i * 0.1f;
+            float expected
+                = table_lookup(&engine->torque_map, throttle, engine->angular_velocity);
+            assert(fabsf(engine_torque(engine, throttle) - expected)
+                <= 1e-5 * fmaxf(1.0, fabsf(expected)));
+        }
+    }
+
+    // Recompiling picks up changes to the map
+    table_set(&engine->torque_map, 1, 7, 300.0);
+    engine_compile(engine);
+    engine->angular_velocity = engine->torque_map.y[7];
+    assert(engine_max_torque(engine) == 300.0);
+    assert(engine_torque(engine, 1.0) == 300.0);
+
+    engine_free(engine);
+
+    return 0;
+}
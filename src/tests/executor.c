@@ -0,0 +1,156 @@
+#include "../executor.h"
+#include "../vehicle.h"
+#include "test.h"
+#include <assert.h>
+#include <string.h>
+
+#define NUM_VEHICLES 77
+
+static bool same(float a, float b) { return memcmp(&a, &b, sizeof a) == 0; }
+
+/** Some vehicles slip their clutch longer or brake with the ABS, so the chunks cost different */
+static raInputs inputs(int step, size_t vehicle)
+{
+    float t = (float)step / 200.0f;
+    float k = (float)(vehicle % 7) / 7.0f;
+    bool braking = step > 300 && vehicle % 3 == 0;
+    return (raInputs) {
+        .throttle = braking ? 0.0f : 0.6f + 0.4f * k,
+        .brake = braking ? 1.0f : 0.0f,
+        .clutch = fmaxf(0.0f, 1.0f - t * t * (0.1f + k)),
+        .steering = deg_to_rad(20.0f * k) * sinf(t),
+    };
+}
+
+static raVehicle* vehicles_new(const raVehicle* v)
+{
+    raVehicle* vehicles = ra_alloc_aligned(
+        &ra_heap_allocator, NUM_VEHICLES * sizeof(raVehicle), RA_CACHE_LINE);
+    for (size_t i = 0; i < NUM_VEHICLES; i++) {
+        assert(ra_vehicle_clone(v, &ra_heap_allocator, &vehicles[i]) == 0);
+    }
+    return vehicles;
+}
+
+/** Each in cache lines of its own in `arena` */
+static raVehicle* vehicles_new_aligned(const raVehicle* v, raArena* arena)
+{
+    raVehicle* vehicles = ra_alloc_aligned(
+        &ra_heap_allocator, NUM_VEHICLES * sizeof(raVehicle), RA_CACHE_LINE);
+    assert(ra_vehicle_clone_aligned(v, NUM_VEHICLES, arena, vehicles) == 0);
+
+    size_t per_clone = arena->used / NUM_VEHICLES;
+    assert(arena->used == arena->capacity && per_clone % RA_CACHE_LINE == 0);
+    for (size_t i = 0; i < NUM_VEHICLES; i++) {
+        unsigned char* first = (unsigned char*)vehicles[i].powertrain.subsystems;
+        assert(first == arena->data + i * per_clone);
+        assert((size_t)first % RA_CACHE_LINE == 0);
+    }
+    return vehicles;
+}
+
+static void vehicles_free(raVehicle* vehicles)
+{
+    for (size_t i = 0; i < NUM_VEHICLES; i++) {
+        ra_vehicle_free(&vehicles[i]);
+    }
+    ra_free(&ra_heap_allocator, vehicles);
+}
+
+int main(void)
+{
+    TireModel model = test_tire_model();
+    raVehicleParams params = test_vehicle_params(&model);
+    raVehicle v;
+    assert(ra_vehicle_init(&v, &params, test_vehicle_parts(&params)) == 0);
+
+    raExecutor one;
+    ra_executor_init(&one, 1);
+    assert(one.num_threads == 1);
+    for (size_t n = 0; n < 5000; n += 7) {
+        size_t chunk = ra_executor_chunk_size(&one, n);
+        assert(chunk > 0);
+        assert(chunk * sizeof(raVehicle) % RA_CACHE_LINE == 0);
+        assert(chunk * sizeof(raVehicle) <= RA_EXECUTOR_CHUNK_BYTES);
+    }
+    ra_executor_free(&one);
+
+    // Stepped in order on this thread
+    raVehicle* expected = vehicles_new(&v);
+    raInputs in[NUM_VEHICLES];
+    for (int step = 0; step < 600; step++) {
+        for (size_t i = 0; i < NUM_VEHICLES; i++) {
+            in[i] = inputs(step, i);
+            ra_vehicle_step(&expected[i], &in[i], 1.0f / 200.0f);
+        }
+    }
+
+    size_t num_threads[] = { 1, 2, 3, 8 };
+    for (size_t t = 0; t < sizeof num_threads / sizeof num_threads[0]; t++) {
+        raExecutor e;
+        ra_executor_init(&e, num_threads[t]);
+        assert(e.num_threads == num_threads[t]);
+        assert((size_t)e.workers % RA_CACHE_LINE == 0);
+
+        raArena arena;
+        raVehicle* vehicles = vehicles_new_aligned(&v, &arena);
+        // Nothing to step
+        ra_executor_step(&e, vehicles, in, 0, 1.0f / 200.0f);
+        for (int step = 0; step < 600; step++) {
+            for (size_t i = 0; i < NUM_VEHICLES; i++) {
+                in[i] = inputs(step, i);
+            }
+            ra_executor_step(&e, vehicles, in, NUM_VEHICLES, 1.0f / 200.0f);
+        }
+
+        for (size_t i = 0; i < NUM_VEHICLES; i++) {
+            assert(same(vehicles[i].position.x, expected[i].position.x));
+            assert(same(vehicles[i].position.y, expected[i].position.y));
+            assert(same(vehicles[i].velocity.x, expected[i].velocity.x));
+            assert(same(vehicles[i].rotation, expected[i].rotation));
+            assert(same(
+                vehicles[i].engine->angular_velocity, expected[i].engine->angular_velocity));
+        }
+
+        ra_free(&ra_heap_allocator, vehicles);
+        ra_arena_free(&arena);
+        ra_executor_free(&e);
+    }
+
+    // The vehicles did not all do the same
+    assert(!same(expected[0].position.x, expected[1].position.x));
+
+    vehicles_free(expected);
+    ra_vehicle_free(&v);
+
+    // A shared surface is built before any thread steps with it
+    TireModel surface_model = test_tire_model();
+    tiremodel_enable_surface(&surface_model, &ra_heap_allocator, tire_surface_config_default());
+    raVehicleParams surface_params = test_vehicle_params(&surface_model);
+    raVehicle sv;
+    assert(ra_vehicle_init(&sv, &surface_params, test_vehicle_parts(&surface_params)) == 0);
+    assert(surface_model.surface->is_built);
+
+    expected = vehicles_new(&sv);
+    raVehicle* vehicles = vehicles_new(&sv);
+    raExecutor e;
+    ra_executor_init(&e, 8);
+    for (int step = 0; step < 200; step++) {
+        for (size_t i = 0; i < NUM_VEHICLES; i++) {
+            in[i] = inputs(step, i);
+            ra_vehicle_step(&expected[i], &in[i], 1.0f / 200.0f);
+        }
+        ra_executor_step(&e, vehicles, in, NUM_VEHICLES, 1.0f / 200.0f);
+    }
+    for (size_t i = 0; i < NUM_VEHICLES; i++) {
+        assert(same(vehicles[i].position.x, expected[i].position.x));
+        assert(same(vehicles[i].velocity.y, expected[i].velocity.y));
+    }
+
+    ra_executor_free(&e);
+    vehicles_free(vehicles);
+    vehicles_free(expected);
+    ra_vehicle_free(&sv);
+    tiremodel_disable_surface(&surface_model);
+    return 0;
+}
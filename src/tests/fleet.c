@@ -0,0 +1,100 @@
+#include "../fleet.h"
+#include "../vehicle.h"
+#include "test.h"
+#include <assert.h>
+#include <string.h>
+
+#define NUM_VEHICLES 6
+
+static bool same(float a, float b) { return memcmp(&a, &b, sizeof a) == 0; }
+
+/** Every vehicle drives differently, and some brake hard enough for the ABS */
+static raInputs inputs(int step, size_t vehicle)
+{
+    float t = (float)step / 200.0f;
+    float k = (float)vehicle / NUM_VEHICLES;
+    bool braking = step > 900 + 100 * (int)vehicle;
+    return (raInputs) {
+        .throttle = braking ? 0.0f : 0.5f + 0.5f * k,
+        .brake = braking ? 0.4f + 0.6f * k : 0.0f,
+        .clutch = fmaxf(0.0f, 1.0f - t * t * 0.09f),
+        .steering = deg_to_rad(90.0f * (k - 0.5f)) * sinf(t * (1.0f + k)),
+    };
+}
+
+int main(void)
+{
+    TireModel model = test_tire_model();
+    raVehicleParams params = test_vehicle_params(&model);
+    raVehicle v;
+    assert(ra_vehicle_init(&v, &params, test_vehicle_parts(&params)) == 0);
+
+    // A component that can not be cloned is reported instead of giving a half copied vehicle
+    raTaggedComponent* c_engine = v.powertrain.subsystems[raVehicleSubsystemEngine];
+    const raComponentOps* engine_ops = c_engine->ops;
+    raComponentOps opaque = *engine_ops;
+    opaque.clone_fn = NULL;
+    c_engine->ops = &opaque;
+    raVehicle clone;
+    assert(ra_vehicle_clone(&v, &ra_heap_allocator, &clone) == RaErrorTaggedNotClonable);
+    c_engine->ops = engine_ops;
+
+    raFleet fleet;
+    ra_fleet_init(&fleet, &v, NUM_VEHICLES);
+    raVehicle alone[NUM_VEHICLES];
+    for (size_t i = 0; i < NUM_VEHICLES; i++) {
+        assert(ra_vehicle_clone(&v, &ra_heap_allocator, &alone[i]) == 0);
+    }
+
+    float dt = 1.0f / 200.0f;
+    raInputs in[NUM_VEHICLES];
+    for (int step = 0; step < 2400; step++) {
+        for (size_t i = 0; i < NUM_VEHICLES; i++) {
+            if (step == 500 + 50 * (int)i) {
+                ra_fleet_upshift(&fleet, i);
+                gearbox_upshift(alone[i].gearbox);
+            }
+
+            in[i] = inputs(step, i);
+            ra_vehicle_step(&alone[i], &in[i], dt);
+        }
+        ra_fleet_step(&fleet, in, dt);
+
+        for (size_t i = 0; i < NUM_VEHICLES; i++) {
+            const raVehicle* a = &alone[i];
+            assert(same(fleet.velocity_x[i], a->velocity.x));
+            assert(same(fleet.velocity_y[i], a->velocity.y));
+            assert(same(fleet.position_x[i], a->position.x));
+            assert(same(fleet.position_y[i], a->position.y));
+            assert(same(fleet.yaw_velocity[i], a->yaw_velocity));
+            assert(same(fleet.rotation[i], a->rotation));
+            assert(same(fleet.engine_torque[i], a->engine_torque));
+            assert(same(fleet.force_x[i], a->force.x) && same(fleet.force_y[i], a->force.y));
+            assert(same(fleet.engine_velocity[i], a->engine->angular_velocity));
+            assert(same(fleet.gearbox_velocity[i], a->gearbox->input_angular_velocity));
+            assert(fleet.clutch_locked[i] == a->clutch->c->is_locked);
+            for (size_t l = 0; l < RA_VEHICLE_NUM_WHEELS; l++) {
+                size_t k = i * RA_VEHICLE_NUM_WHEELS + l;
+                const Wheel* w = a->wheels[l];
+                assert(same(fleet.lanes.angular_velocity[k], w->angular_velocity));
+                assert(same(fleet.lanes.hub_velocity_x[k], w->hub_velocity.x));
+                assert(same(fleet.lanes.angle[k], w->angle));
+                assert(same(fleet.lanes.input_torque[k], w->input_torque));
+                assert(same(fleet.lanes.reaction_torque[k], w->reaction_torque));
+                assert(same(fleet.lanes.external_torque[k], w->external_torque));
+                assert(same(fleet.wheel_forces[k].x, a->wheel_forces[l].x));
+            }
+        }
+    }
+
+    // The vehicles went their own ways
+    assert(!same(fleet.position_y[0], fleet.position_y[NUM_VEHICLES - 1]));
+    assert(fleet.gears[0] == 2);
+
+    for (size_t i = 0; i < NUM_VEHICLES; i++) {
+        ra_vehicle_free(&alone[i]);
+    }
+    ra_fleet_free(&fleet);
+    ra_vehicle_free(&v);
+    return 0;
+}
@@ -0,0 +1,326 @@
+#include "../powertrain.h"
+#include "../powertrainabs.h"
+#include "../wheel.h"
+#include "test.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_WHEELS 4
+
+typedef struct {
+    Engine* engine;
+    ClutchTagged* clutch;
+    Gearbox* gb;
+    Differential* diffs[3];
+    Wheel* wheels[NUM_WHEELS];
+    raPowertrainSystem sys;
+} Vehicle;
+
+/** Four wheel drive with a locked center diff, an open front and a locked rear diff */
+static Vehicle vehicle_new(void)
+{
+    Vehicle v;
+    v.engine = test_engine();
+    // Starts rolling at 4 m/s with the engine matching the wheels, so the clutch can lock
+    float wheel_velocity = 4.0f / 0.344f;
+    v.engine->angular_velocity = wheel_velocity * 3.2f * 3.2f;
+    float clutch_normal_force;
+    Clutch* clutch = clutch_with_torque(&clutch_normal_force, 300.0, 240.0);
+    v.gb = test_gearbox();
+    v.gb->curr_gear = 1;
+    v.diffs[0] = differential_new(1.0, 0.1, DiffTypeLocked);
+    v.diffs[1] = differential_new(3.2, 0.15, DiffTypeOpen);
+    v.diffs[2] = differential_new(3.2, 0.18, DiffTypeLocked);
+    for (int i = 0; i < NUM_WHEELS; i++) {
+        v.wheels[i] = wheel_new(0.6, 0.344, (Vector2f) { .x = 1.0, .y = i % 2 ? 0.7 : -0.7 }, 0.1);
+        v.wheels[i]->angular_velocity = wheel_velocity;
+        v.wheels[i]->hub_velocity.x = 4.0f;
+    }
+
+    raTaggedComponent* engine = ra_tag_engine(v.engine);
+    raTaggedComponent* c_clutch = ra_tag_clutch(clutch);
+    v.clutch = (ClutchTagged*)ra_tagged_component_inner(c_clutch);
+    raTaggedComponent* gb = ra_tag_gearbox(v.gb);
+    raTaggedComponent* center = ra_tag_differential(v.diffs[0]);
+    raTaggedComponent* front = ra_tag_differential(v.diffs[1]);
+    raTaggedComponent* rear = ra_tag_differential(v.diffs[2]);
+
+    assert(ra_tagged_add_next(engine, c_clutch) == 0);
+    assert(ra_tagged_add_next(c_clutch, gb) == 0);
+    assert(ra_tagged_add_next(gb, center) == 0);
+    assert(ra_tagged_add_next_left(center, front) == 0);
+    assert(ra_tagged_add_next_right(center, rear) == 0);
+    assert(ra_tagged_add_next_left(front, ra_tag_wheel(v.wheels[0])) == 0);
+    assert(ra_tagged_add_next_right(front, ra_tag_wheel(v.wheels[1])) == 0);
+    assert(ra_tagged_add_next_left(rear, ra_tag_wheel(v.wheels[2])) == 0);
+    assert(ra_tagged_add_next_right(rear, ra_tag_wheel(v.wheels[3])) == 0);
+
+    // An undriven subsystem as well
+    Wheel* spare = wheel_new(0.6, 0.344, vector2f_default(), 0.1);
+    v.sys = RA_POWERTRAIN_SYSTEM(ra_tag_wheel(spare), engine);
+    return v;
+}
+
+static void set_inputs(Vehicle* v, int step)
+{
+    // Locked, then slipping after a shift, with some braking at the end
+    v->clutch->curr_normal_force = step < 250 ? 300.0f : 300.0f * (float)(step - 250) / 500.0f;
+    v->gb->curr_gear = step < 250 ? 1 : 2;
+    v->diffs[2]->ty = step >= 100 && step < 200 ? DiffTypeOpen : DiffTypeLocked;
+    for (int i = 0; i < NUM_WHEELS; i++) {
+        Wheel* w = v->wheels[i];
+        w->reaction_torque
+            = -(w->angular_velocity * w->effective_radius - 4.0f) * 10.0f * (float)(i + 1);
+        w->external_torque = step > 300 ? -300.0f * signum(w->angular_velocity) : 0.0f;
+    }
+}
+
+static bool same(float a, float b) { return memcmp(&a, &b, sizeof a) == 0; }
+
+/** The cached inertias match what the graph would compute for the current state */
+static void check_inertia(raPowertrainSchedule* s)
+{
+    for (size_t i = 0; i < s->num_nodes; i++) {
+        const raScheduleNode* n = &s->nodes[i];
+        if (n->parent != SIZE_MAX) {
+            float cached = ra_powertrain_schedule_inertia_prev(s, n->parent, n->slot);
+            raTaggedComponent* parent = s->nodes[n->parent].c;
+            assert(same(cached, ra_tagged_inertia(parent, n->c, raInertiaDirectionPrev)));
+        }
+    }
+}
+
+/** Component callbacks wrapped to count evaluations and to shift gear in the middle of a send */
+typedef struct {
+    raComponentOps ops;
+    raFlatOps flat;
+    const raComponentOps* inner;
+} Wrapped;
+
+static Wrapped wrapped[32];
+static size_t num_wrapped;
+/** Angular velocities and external torques worked out during sends */
+static size_t graph_evaluations;
+static size_t flat_evaluations;
+/** The send each node last answered a memoized query in */
+static unsigned answered[32][raNumQueries];
+/** `shifting` shifts into `shift_gear` the next time it is sent to. 0 for no shift. */
+static Gearbox* shifting;
+static int shift_gear;
+
+static const raComponentOps* inner(raTaggedComponent* t) { return ((const Wrapped*)t->ops)->inner; }
+
+static float graph_angular_velocity(raTaggedComponent* t)
+{
+    graph_evaluations++;
+    return inner(t)->angular_velocity_fn(t);
+}
+
+static float graph_external_torque(raTaggedComponent* t)
+{
+    graph_evaluations++;
+    return inner(t)->external_torque(t);
+}
+
+static void shift(raTaggedComponent* t)
+{
+    if (t->ty == shifting && shift_gear != 0) {
+        shifting->curr_gear = shift_gear;
+        shift_gear = 0;
+    }
+}
+
+static void graph_send_torque(raTaggedComponent* t, raVelocities v, float torque, float dt)
+{
+    shift(t);
+    inner(t)->send_torque_fn(t, v, torque, dt);
+}
+
+static float flat_query(raPowertrainSchedule* s, size_t node, raQuery q, const float children[2])
+{
+    if (s->sending && (q == raQueryAngularVelocity || q == raQueryExternalTorque)) {
+        // Worked out at most once per node and send, later questions reuse the answer
+        assert(answered[node][q] != s->send_count);
+        answered[node][q] = s->send_count;
+        flat_evaluations++;
+    }
+    return inner(s->nodes[node].c)->flat_ops->query(s, node, q, children);
+}
+
+static void flat_send_torque(
+    raPowertrainSchedule* s, size_t node, raVelocities v, float torque, float dt)
+{
+    raTaggedComponent* c = s->nodes[node].c;
+    if (c->ty == shifting && shift_gear != 0) {
+        shift(c);
+        // The gear is not part of the inertia keys until the next send
+        ra_powertrain_schedule_invalidate_inertia(s);
+    }
+    inner(c)->flat_ops->send_torque(s, node, v, torque, dt);
+}
+
+static void wrap(raTaggedComponent* t)
+{
+    if (t == NULL) {
+        return;
+    }
+
+    assert(num_wrapped < sizeof wrapped / sizeof wrapped[0]);
+    Wrapped* w = &wrapped[num_wrapped++];
+    w->inner = t->ops;
+    w->ops = *t->ops;
+    w->flat = *t->ops->flat_ops;
+    w->ops.angular_velocity_fn = graph_angular_velocity;
+    w->ops.external_torque = graph_external_torque;
+    w->ops.send_torque_fn = graph_send_torque;
+    w->ops.flat_ops = &w->flat;
+    w->flat.query = flat_query;
+    w->flat.send_torque = flat_send_torque;
+    t->ops = &w->ops;
+
+    if (t->comp_ty == raTySplit) {
+        wrap(t->tty.split.next_left);
+        wrap(t->tty.split.next_right);
+    } else {
+        wrap(t->tty.normal.next);
+    }
+}
+
+/** Gear changes in the middle of a send, and the clutch slipping and locking again in its own
+ * send, give the same results as the graph while each answer is still only worked out once */
+static void shift_mid_send(void)
+{
+    Vehicle graph = vehicle_new();
+    Vehicle flat = vehicle_new();
+    for (size_t i = 0; i < graph.sys.num_subsystems; i++) {
+        wrap(graph.sys.subsystems[i]);
+        wrap(flat.sys.subsystems[i]);
+    }
+
+    raPowertrainSchedule schedule;
+    assert(ra_powertrain_schedule_compile(flat.sys, &ra_heap_allocator, &schedule) == 0);
+
+    raVelocities vel = { .velocity_cog = { .x = 4.0, .y = 0.0 }, .yaw_velocity_cog = 0.0 };
+    float dt = 1.0 / 200.0;
+    int unlocks = 0;
+    int locks = 0;
+    for (int step = 0; step < 600; step++) {
+        // The clutch is released for a shift halfway through, and then engaged again
+        int since = step % 250 - 100;
+        float normal_force = since < 0 ? 300.0f : since < 10 ? 0.0f : 3.0f * (float)(since - 10);
+        graph.clutch->curr_normal_force = fminf(normal_force, 300.0f);
+        flat.clutch->curr_normal_force = fminf(normal_force, 300.0f);
+        int gear = step == 105 ? 2 : step == 355 ? 1 : 0;
+        float torque = since >= 0 && since < 40 ? 5.0f : 40.0f;
+        for (int i = 0; i < NUM_WHEELS; i++) {
+            graph.wheels[i]->reaction_torque = -80.0f;
+            flat.wheels[i]->reaction_torque = -80.0f;
+        }
+
+        shifting = graph.gb;
+        shift_gear = gear;
+        ra_tagged_send_torque(graph.sys.subsystems[0], 0.0, vel, dt);
+        ra_tagged_send_torque(graph.sys.subsystems[1], torque, vel, dt);
+        for (size_t i = 0; i < graph.sys.num_subsystems; i++) {
+            ra_tagged_update_angular_velocity(graph.sys.subsystems[i]);
+        }
+
+        bool was_locked = flat.clutch->c->is_locked;
+        shifting = flat.gb;
+        shift_gear = gear;
+        ra_powertrain_schedule_send_torque(&schedule, 0, 0.0, vel, dt);
+        ra_powertrain_schedule_send_torque(&schedule, 1, torque, vel, dt);
+        ra_powertrain_schedule_update_angular_velocity(&schedule);
+        assert(shift_gear == 0);
+        unlocks += was_locked && !flat.clutch->c->is_locked;
+        locks += !was_locked && flat.clutch->c->is_locked;
+
+        assert(flat.gb->curr_gear == graph.gb->curr_gear);
+        assert(graph.clutch->c->is_locked == flat.clutch->c->is_locked);
+        assert(same(graph.engine->angular_velocity, flat.engine->angular_velocity));
+        assert(same(graph.gb->input_angular_velocity, flat.gb->input_angular_velocity));
+        for (int i = 0; i < NUM_WHEELS; i++) {
+            assert(same(graph.wheels[i]->angular_velocity, flat.wheels[i]->angular_velocity));
+        }
+        check_inertia(&schedule);
+    }
+
+    // Locked in the first step, and slipping at both shifts until it locked again
+    assert(unlocks == 2 && locks == 3);
+    // The graph works an answer out again every time it is needed
+    assert(flat_evaluations > 0 && flat_evaluations < graph_evaluations);
+
+    ra_powertrain_schedule_free(&schedule);
+    ra_powertrain_system_free(graph.sys);
+    ra_powertrain_system_free(flat.sys);
+}
+
+int main(void)
+{
+    Vehicle graph = vehicle_new();
+    Vehicle flat = vehicle_new();
+
+    raPowertrainSchedule schedule;
+    assert(ra_powertrain_schedule_compile(flat.sys, &ra_heap_allocator, &schedule) == 0);
+    assert(schedule.num_nodes == 11);
+    assert(schedule.num_roots == 2);
+    assert(schedule.nodes[schedule.roots[1]].end == schedule.num_nodes);
+
+    raVelocities vel = { .velocity_cog = { .x = 4.0, .y = 0.3 }, .yaw_velocity_cog = 0.05 };
+    float dt = 1.0 / 200.0;
+
+    int locked_steps = 0;
+    for (int step = 0; step < 400; step++) {
+        set_inputs(&graph, step);
+        set_inputs(&flat, step);
+        float torque = step % 50 < 40 ? 150.0f : -20.0f;
+
+        ra_tagged_send_torque(graph.sys.subsystems[0], 0.0, vel, dt);
+        ra_tagged_send_torque(graph.sys.subsystems[1], torque, vel, dt);
+        for (size_t i = 0; i < graph.sys.num_subsystems; i++) {
+            ra_tagged_update_angular_velocity(graph.sys.subsystems[i]);
+        }
+
+        ra_powertrain_schedule_send_torque(&schedule, 0, 0.0, vel, dt);
+        ra_powertrain_schedule_send_torque(&schedule, 1, torque, vel, dt);
+        ra_powertrain_schedule_update_angular_velocity(&schedule);
+        check_inertia(&schedule);
+
+        assert(same(graph.engine->angular_velocity, flat.engine->angular_velocity));
+        assert(same(graph.gb->input_angular_velocity, flat.gb->input_angular_velocity));
+        assert(graph.clutch->c->is_locked == flat.clutch->c->is_locked);
+        locked_steps += graph.clutch->c->is_locked;
+        // Nothing gets through a slipping clutch
+        float ext_torque = ra_tagged_external_torque(graph.sys.subsystems[1]);
+        assert(same(ext_torque,
+            ra_powertrain_schedule_query(&schedule, schedule.roots[1], raQueryExternalTorque)));
+        assert(graph.clutch->c->is_locked || ext_torque == 0.0f);
+        for (int i = 0; i < NUM_WHEELS; i++) {
+            assert(same(graph.wheels[i]->angular_velocity, flat.wheels[i]->angular_velocity));
+            assert(same(graph.wheels[i]->hub_velocity.x, flat.wheels[i]->hub_velocity.x));
+        }
+    }
+
+    // Values are only reused within a send
+    assert(schedule.send_count == 800 && !schedule.sending);
+
+    // Both clutch states were covered
+    assert(locked_steps > 0 && locked_steps < 400);
+
+    ra_powertrain_schedule_free(&schedule);
+    ra_powertrain_system_free(graph.sys);
+    ra_powertrain_system_free(flat.sys);
+
+    shift_mid_send();
+
+    // Components without flat callbacks can not be compiled
+    raTaggedComponent* opaque = ra_tagged_new(malloc(1), NULL, NULL, NULL, NULL, NULL, NULL, free);
+    raPowertrainSystem sys = RA_POWERTRAIN_SYSTEM(opaque);
+    assert(ra_powertrain_schedule_compile(sys, &ra_heap_allocator, &schedule)
+        == RaErrorTaggedNotCompilable);
+    ra_powertrain_system_free(sys);
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "../scenario.h"
+#include "test.h"
+#include <assert.h>
+
+static bool approx(float a, float b) { return fabsf(a - b) < 1e-5f; }
+
+static void assert_syntax_error(const char* text, size_t expected_line)
+{
+    raScenario s;
+    size_t line = 0;
+    assert(ra_scenario_parse(&s, text, &line) == RaErrorScenarioSyntax);
+    assert(line == expected_line);
+}
+
+int main(void)
+{
+    assert_syntax_error("throttle 0 1\n", 1);
+    assert_syntax_error("stage\n\n# times must increase\nclutch 0 1 2 0.5 1 0\n", 4);
+    assert_syntax_error("stage\nthrottle 0\n", 2);
+    assert_syntax_error("stage\nthrottle 0 1x\n", 2);
+    assert_syntax_error("stage\nthrottle\n", 2);
+    assert_syntax_error("stage\nthrottle 0 1\nthrottle 1 1\n", 3);
+    assert_syntax_error("stage\nuntil speed > 3\n", 2);
+    assert_syntax_error("stage\nuntil mass >= 3\n", 2);
+    assert_syntax_error("stage\nuntil speed >= 3 4\n", 2);
+    assert_syntax_error("stage 2\n", 1);
+    assert_syntax_error("stage\nwipers 0 1\n", 2);
+
+    raScenario s;
+    assert(ra_scenario_parse(&s, "# nothing\n\n", NULL) == RaErrorScenarioEmpty);
+    assert(ra_scenario_load(&s, "does/not/exist.scenario", NULL) == RaErrorScenarioIo);
+
+    const char* text = "# Launch, then brake\n"
+                       "stage\n"
+                       "throttle 0 1\n"
+                       "clutch 0 1 1 0.5 2 0   # ramp\n"
+                       "steering 1 0 2 0.1\n"
+                       "until speed >= 3\n"
+                       "until time >= 100\n"
+                       "stage\n"
+                       "\tthrottle 0 0\n"
+                       "brake 0 0.5 0.5 1\n"
+                       "until stage_time >= 0.8\n"
+                       "stage\r\n"
+                       "until gear >= 1\n";
+    assert(ra_scenario_parse(&s, text, NULL) == 0);
+    assert(s.num_stages == 3);
+    assert(s.num_conditions == 4);
+    assert(s.num_keys == 9);
+
+    TireModel model = test_tire_model();
+    raVehicleParams params = test_vehicle_params(&model);
+    raVehicle v;
+    assert(ra_vehicle_init(&v, &params, test_vehicle_parts(&params)) == 0);
+
+    // Time is kept in floats, so the steps are binary fractions
+    float dt = 1.0f / 4.0f;
+    raScenarioCursor c = ra_scenario_cursor_new(&s);
+    raInputs in;
+    v.velocity.x = 0.0f;
+    float expected_clutch[] = { 1.0f, 0.875f, 0.75f, 0.625f, 0.5f, 0.375f, 0.25f, 0.125f, 0.0f };
+    for (int i = 0; i < 12; i++) {
+        assert(ra_scenario_next(&s, &c, &v, dt, &in));
+        assert(c.stage == 0);
+        assert(in.throttle == 1.0f && in.brake == 0.0f);
+        assert(approx(in.clutch, i < 9 ? expected_clutch[i] : 0.0f));
+        float t = (float)i * dt;
+        assert(approx(in.steering, t < 1.0f ? 0.0f : t < 2.0f ? (t - 1.0f) * 0.1f : 0.1f));
+    }
+
+    // Braking holds the clutch and steering of the launch
+    v.velocity.x = 3.0f;
+    assert(ra_scenario_next(&s, &c, &v, dt, &in));
+    assert(c.stage == 1);
+    assert(in.throttle == 0.0f && in.brake == 0.5f);
+    assert(in.clutch == 0.0f && approx(in.steering, 0.1f));
+    assert(ra_scenario_next(&s, &c, &v, dt, &in));
+    assert(approx(in.brake, 0.75f));
+    assert(ra_scenario_next(&s, &c, &v, dt, &in));
+    assert(in.brake == 1.0f);
+    assert(ra_scenario_next(&s, &c, &v, dt, &in));
+    assert(in.brake == 1.0f);
+
+    // The last two stages end at once
+    assert(!ra_scenario_next(&s, &c, &v, dt, &in));
+    assert(c.stage == 3);
+    assert(!ra_scenario_next(&s, &c, &v, dt, &in));
+
+    ra_vehicle_free(&v);
+    ra_scenario_free(&s);
+    return 0;
+}
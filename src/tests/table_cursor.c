@@ -0,0 +1,55 @@
+#include "../common.h"
+#include "test.h"
+#include <assert.h>
+#include <stdlib.h>
+
+int main(void)
+{
+    Engine* engine = test_engine();
+    const Table* table = &engine->torque_map;
+    TableCursor cursor = table_cursor_new();
+
+    // Smooth sweep up and down the rpm range, including beyond both ends
+    for (int i = -50; i <= 750; i++) {
+        float x = (float)(i % 100) * 0.01f;
+        float y = (float)i;
+        assert(table_lookup_cursor(table, &cursor, x, y) == table_lookup(table, x, y));
+    }
+
+    for (int i = 750; i >= -50; i--) {
+        float y = (float)i;
+        assert(table_lookup_cursor(table, &cursor, 1.0, y) == table_lookup(table, 1.0, y));
+    }
+
+    // Exactly on the breakpoints, including the duplicated one
+    for (size_t i = 0; i < table->y_capacity; i++) {
+        float y = table->y[i];
+        assert(table_lookup_cursor(table, &cursor, 0.5, y) == table_lookup(table, 0.5, y));
+    }
+
+    // Large jumps
+    srand(3);
+    for (int i = 0; i < 1000; i++) {
+        float x = (float)rand() / (float)RAND_MAX * 1.2f - 0.1f;
+        float y = (float)rand() / (float)RAND_MAX * 800.0f - 50.0f;
+        assert(table_lookup_cursor(table, &cursor, x, y) == table_lookup(table, x, y));
+    }
+
+    // A cursor from a larger table is still valid
+    Table small = table_with_capacity(2, 2);
+    small.x[0] = 0.0;
+    small.x[1] = 1.0;
+    small.y[0] = 0.0;
+    small.y[1] = 1.0;
+    table_set(&small, 0, 0, 0.0);
+    table_set(&small, 0, 1, 1.0);
+    table_set(&small, 1, 0, 2.0);
+    table_set(&small, 1, 1, 3.0);
+    cursor.yi = table->y_capacity;
+    assert(table_lookup_cursor(&small, &cursor, 0.5, 0.5) == table_lookup(&small, 0.5, 0.5));
+
+    table_free(&small);
+    engine_free(engine);
+
+    return 0;
+}
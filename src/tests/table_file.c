@@ -0,0 +1,68 @@
+#include "../common.h"
+#include "../tablefile.h"
+#include "test.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PATH "test_table_file.ratb"
+
+int main(void)
+{
+    Engine* engine = test_engine();
+    const Table* map = &engine->torque_map;
+    assert(table_file_write(map, PATH) == 0);
+
+    TableMapping mapping;
+    assert(table_file_map(&mapping, PATH) == 0);
+    const Table* t = &mapping.table;
+
+    assert(t->x_capacity == map->x_capacity && t->y_capacity == map->y_capacity);
+    assert(!t->x_uniform && !t->y_uniform);
+    assert(memcmp(t->x, map->x, map->x_capacity * sizeof(float)) == 0);
+    assert(memcmp(t->y, map->y, map->y_capacity * sizeof(float)) == 0);
+    assert(memcmp(t->z, map->z, map->x_capacity * map->y_capacity * sizeof(float)) == 0);
+
+    for (int rpm = 0; rpm < 7000; rpm += 50) {
+        float y = rpm_to_rads((float)rpm);
+        assert(table_lookup(t, 0.3, y) == table_lookup(map, 0.3, y));
+    }
+
+    table_file_unmap(&mapping);
+
+    // Uniform flags survive
+    Table uniform = table_resample_uniform(map, 3, 20);
+    assert(table_file_write(&uniform, PATH) == 0);
+    assert(table_file_map(&mapping, PATH) == 0);
+    assert(mapping.table.x_uniform && mapping.table.y_uniform);
+    assert(table_lookup(&mapping.table, 0.7, 123.0) == table_lookup(&uniform, 0.7, 123.0));
+    table_file_unmap(&mapping);
+    table_free(&uniform);
+
+    // Not a table file
+    FILE* fs = fopen(PATH, "wb");
+    assert(fs != NULL);
+    fputs("definitely not a table file", fs);
+    fclose(fs);
+    assert(table_file_map(&mapping, PATH) == RaErrorTableFileFormat);
+
+    assert(table_file_map(&mapping, "does_not_exist.ratb") == RaErrorTableFileIo);
+
+    // Only the current version is read
+    uint32_t versions[] = { 0, RA_TABLE_FILE_VERSION + 1 };
+    for (size_t i = 0; i < sizeof versions / sizeof versions[0]; i++) {
+        assert(table_file_write(map, PATH) == 0);
+        fs = fopen(PATH, "r+b");
+        assert(fs != NULL);
+        unsigned char version[4] = { (unsigned char)versions[i], 0, 0, 0 };
+        assert(fseek(fs, 4, SEEK_SET) == 0 && fwrite(version, sizeof version, 1, fs) == 1);
+        fclose(fs);
+        assert(table_file_map(&mapping, PATH) == RaErrorTableFileVersion);
+    }
+
+    remove(PATH);
+    engine_free(engine);
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "../common.h"
+#include "test.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_QUERIES 1003
+
+static void assert_same_as_scalar(const Table* table, const float* x, const float* y, size_t n)
+{
+    float out[NUM_QUERIES];
+    table_lookup_n(table, x, y, out, n);
+
+    for (size_t i = 0; i < n; i++) {
+        float expected = table_lookup(table, x[i], y[i]);
+        // Bitwise comparison
+        assert(memcmp(&out[i], &expected, sizeof expected) == 0);
+    }
+}
+
+int main(void)
+{
+    Engine* engine = test_engine();
+    Table uniform = table_resample_uniform(&engine->torque_map, 5, 50);
+
+    float x[NUM_QUERIES], y[NUM_QUERIES];
+    srand(2);
+    for (size_t i = 0; i < NUM_QUERIES; i++) {
+        // Includes queries outside the table
+        x[i] = (float)rand() / (float)RAND_MAX * 1.4f - 0.2f;
+        y[i] = (float)rand() / (float)RAND_MAX * 800.0f - 50.0f;
+    }
+
+    // Exactly on the breakpoints
+    for (size_t i = 0; i < engine->torque_map.y_capacity; i++) {
+        x[i] = engine->torque_map.x[i % engine->torque_map.x_capacity];
+        y[i] = engine->torque_map.y[i];
+    }
+
+    // Every tail length
+    for (size_t n = 0; n < 17; n++) {
+        assert_same_as_scalar(&engine->torque_map, x, y, n);
+    }
+
+    assert_same_as_scalar(&engine->torque_map, x, y, NUM_QUERIES);
+    assert_same_as_scalar(&uniform, x, y, NUM_QUERIES);
+
+    // On and right next to the breakpoints of evenly spaced axes, where the computed cell is
+    // corrected by the search
+    Table fine = table_resample_uniform(&engine->torque_map, 3, 700);
+    for (size_t i = 0; i < NUM_QUERIES; i++) {
+        size_t j = i / 3 % fine.y_capacity;
+        x[i] = fine.x[i % fine.x_capacity];
+        y[i] = i % 3 == 0 ? fine.y[j] : nextafterf(fine.y[j], i % 3 == 1 ? -INFINITY : INFINITY);
+    }
+    assert_same_as_scalar(&fine, x, y, NUM_QUERIES);
+    assert_same_as_scalar(&uniform, x, y, NUM_QUERIES);
+
+    // Values the search can not compute a start for
+    float odd[] = { NAN, INFINITY, -INFINITY, 1e30f, -1e30f, 0.0f, -0.0f, 650.0f };
+    for (size_t i = 0; i < 8; i++) {
+        x[i] = odd[(i + 3) % 8];
+        y[i] = odd[i];
+    }
+    assert_same_as_scalar(&fine, x, y, 8);
+    assert_same_as_scalar(&engine->torque_map, x, y, 8);
+
+    table_free(&fine);
+    table_free(&uniform);
+    engine_free(engine);
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include "../common.h"
+#include <assert.h>
+
+static Table scan_copy(const Table* t)
+{
+    Table c = table_with_capacity(t->x_capacity, t->y_capacity);
+    for (size_t i = 0; i < t->x_capacity; i++) {
+        c.x[i] = t->x[i];
+        for (size_t j = 0; j < t->y_capacity; j++) {
+            table_set(&c, i, j, table_get(t, i, j));
+        }
+    }
+
+    for (size_t j = 0; j < t->y_capacity; j++) {
+        c.y[j] = t->y[j];
+    }
+
+    return c;
+}
+
+int main(void)
+{
+    Table table = table_uniform_with_capacity(3, 0.0, 1.0, 61, 0.0, 628.3185307179587);
+    assert(table.x_uniform && table.y_uniform);
+    assert(table.x[0] == 0.0f && table.x[2] == 1.0f);
+    assert(table.y[60] == 628.3185307179587f);
+
+    for (size_t i = 0; i < table.x_capacity; i++) {
+        for (size_t j = 0; j < table.y_capacity; j++) {
+            table_set(&table, i, j, (float)(i + 1) * 150.0f * sinf((float)j * 0.1f) - 50.0f);
+        }
+    }
+
+    Table scan = scan_copy(&table);
+    assert(!scan.x_uniform && !scan.y_uniform);
+
+    // Includes every breakpoint and values outside of the table for extrapolation
+    for (int i = -20; i <= 120; i++) {
+        float x = (float)i * 0.01f;
+        for (int j = -100; j <= 800; j++) {
+            float y = (float)j * 0.87f;
+            assert(table_lookup(&table, x, y) == table_lookup(&scan, x, y));
+        }
+
+        for (size_t j = 0; j < table.y_capacity; j++) {
+            float y = table.y[j];
+            assert(table_lookup(&table, x, y) == table_lookup(&scan, x, y));
+        }
+    }
+
+    // Resampling onto the same breakpoints reproduces the table
+    Table resampled = table_resample_uniform(&scan, scan.x_capacity, scan.y_capacity);
+    for (size_t i = 0; i < resampled.x_capacity; i++) {
+        for (size_t j = 0; j < resampled.y_capacity; j++) {
+            assert(fabsf(table_get(&resampled, i, j) - table_get(&table, i, j)) < 1e-3);
+        }
+    }
+
+    table_free(&resampled);
+    table_free(&scan);
+    table_free(&table);
+
+    return 0;
+}
@@ -0,0 +1,44 @@
+#include "../powertrain.h"
+#include "test.h"
+#include <assert.h>
+#include <stddef.h>
+
+static const float throttle[] = { 0.0f, 1.0f };
+static const float rpm[] = { 0.0f, 200.0f, 400.0f, 600.0f };
+static const float torque[] = {
+    -50.0f, -55.0f, -60.0f, -65.0f,
+    -50.0f, 120.0f, 150.0f, 90.0f,
+};
+
+int main(void)
+{
+    Table view = table_view(2, throttle, 4, rpm, torque);
+    assert(!view.owned);
+    assert(view.x == throttle && view.z == torque);
+    assert(view.x_uniform && view.y_uniform);
+    assert(table_lookup(&view, 1.0, 300.0) == 135.0);
+
+    // Engines sharing a static map, freeing them leaves the map alone
+    Engine* a = engine_new(0.5, view);
+    Engine* b = engine_new(0.5, view);
+    engine_set_angular_velocity(a, 200.0);
+    engine_set_angular_velocity(b, 200.0);
+    assert(engine_max_torque(a) == 120.0 && engine_max_torque(b) == 120.0);
+    engine_free(a);
+    engine_free(b);
+    assert(torque[5] == 120.0f);
+
+    // Borrowing an owned table
+    Engine* owner = test_engine();
+    Engine* sharer = engine_new(0.5, table_borrow(&owner->torque_map));
+    assert(sharer->torque_map.z == owner->torque_map.z);
+    engine_free(sharer);
+    engine_set_angular_velocity(owner, 300.0);
+    assert(engine_torque(owner, 1.0) == table_lookup(&owner->torque_map, 1.0, 300.0));
+    engine_free(owner);
+
+    table_free(&view);
+    assert(view.x == NULL);
+
+    return 0;
+}
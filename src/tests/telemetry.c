@@ -0,0 +1,81 @@
+#include "../telemetry.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <zlib.h>
+
+#define PATH "test_telemetry.ratl.gz"
+#define NUM_CHANNELS 3
+/** Several full chunks and a partial one */
+#define NUM_ROWS (3 * RA_TELEMETRY_CHUNK_ROWS + 100)
+
+static uint32_t read_u32(gzFile file)
+{
+    uint32_t v;
+    assert(gzread(file, &v, sizeof v) == sizeof v);
+    return v;
+}
+
+static float value(size_t row, size_t ch) { return (float)row * 0.5f + (float)ch * 1000.0f; }
+
+int main(void)
+{
+    const char* names[NUM_CHANNELS] = { "elapsed_time", "engine.torque", "fl_wheel.angle" };
+    raTelemetry t;
+    assert(ra_telemetry_open(&t, "does/not/exist/" PATH, names, NUM_CHANNELS)
+        == RaErrorTelemetryIo);
+
+    // Nothing recorded still makes a valid stream
+    assert(ra_telemetry_open(&t, PATH, names, NUM_CHANNELS) == 0);
+    assert(ra_telemetry_close(&t) == 0);
+    gzFile file = gzopen(PATH, "rb");
+    assert(file != NULL);
+    char magic[4];
+    assert(gzread(file, magic, 4) == 4 && memcmp(magic, "RATL", 4) == 0);
+    assert(read_u32(file) == RA_TELEMETRY_VERSION);
+    assert(read_u32(file) == NUM_CHANNELS);
+    gzclose(file);
+
+    assert(ra_telemetry_open(&t, PATH, names, NUM_CHANNELS) == 0);
+    for (size_t row = 0; row < NUM_ROWS; row++) {
+        float values[NUM_CHANNELS];
+        for (size_t ch = 0; ch < NUM_CHANNELS; ch++) {
+            values[ch] = value(row, ch);
+        }
+        ra_telemetry_record(&t, values);
+    }
+    assert(ra_telemetry_close(&t) == 0);
+
+    file = gzopen(PATH, "rb");
+    assert(file != NULL);
+    assert(gzread(file, magic, 4) == 4 && memcmp(magic, "RATL", 4) == 0);
+    assert(read_u32(file) == RA_TELEMETRY_VERSION);
+    assert(read_u32(file) == NUM_CHANNELS);
+    for (size_t ch = 0; ch < NUM_CHANNELS; ch++) {
+        uint32_t len = read_u32(file);
+        char name[32] = { 0 };
+        assert(len == strlen(names[ch]) && gzread(file, name, len) == (int)len);
+        assert(strcmp(name, names[ch]) == 0);
+    }
+
+    size_t row = 0;
+    uint32_t rows;
+    while (gzread(file, &rows, sizeof rows) == sizeof rows) {
+        assert(rows > 0 && rows <= RA_TELEMETRY_CHUNK_ROWS);
+        for (size_t ch = 0; ch < NUM_CHANNELS; ch++) {
+            float column[RA_TELEMETRY_CHUNK_ROWS];
+            assert(gzread(file, column, rows * sizeof(float)) == (int)(rows * sizeof(float)));
+            for (size_t i = 0; i < rows; i++) {
+                assert(column[i] == value(row + i, ch));
+            }
+        }
+        row += rows;
+    }
+    assert(row == NUM_ROWS);
+    assert(gzeof(file));
+    gzclose(file);
+
+    remove(PATH);
+    return 0;
+}
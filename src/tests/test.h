@@ -1,6 +1,7 @@
 #ifndef RA_TEST_TEST_H
 #define RA_TEST_TEST_H
 #include "../powertrain.h"
+#include "../vehicle.h"
 
 Engine* test_engine(void)
 {
@@ -21,34 +22,34 @@ Engine* test_engine(void)
     torque_map.y[11] = 523.5987755982989;
     torque_map.y[12] = 575.9586531581288;
     torque_map.y[13] = 628.3185307179587;
-    torque_map.z[0][0] = -50.0;
-    torque_map.z[0][1] = -53.1415926535898;
-    torque_map.z[0][2] = -53.1415926535898;
-    torque_map.z[0][3] = -56.283185307179586;
-    torque_map.z[0][4] = -59.424777960769376;
-    torque_map.z[0][5] = -62.56637061435917;
-    torque_map.z[0][6] = -65.70796326794897;
-    torque_map.z[0][7] = -68.84955592153875;
-    torque_map.z[0][8] = -71.99114857512855;
-    torque_map.z[0][9] = -75.13274122871834;
-    torque_map.z[0][10] = -78.27433388230814;
-    torque_map.z[0][11] = -81.41592653589794;
-    torque_map.z[0][12] = -84.55751918948772;
-    torque_map.z[0][13] = -87.69911184307752;
-    torque_map.z[1][0] = -50.0;
-    torque_map.z[1][1] = -53.1415926535898;
-    torque_map.z[1][2] = 15.0;
-    torque_map.z[1][3] = 60.0;
-    torque_map.z[1][4] = 90.0;
-    torque_map.z[1][5] = 120.0;
-    torque_map.z[1][6] = 142.5;
-    torque_map.z[1][7] = 150.0;
-    torque_map.z[1][8] = 148.5;
-    torque_map.z[1][9] = 139.5;
-    torque_map.z[1][10] = 127.5;
-    torque_map.z[1][11] = 112.5;
-    torque_map.z[1][12] = 90.0;
-    torque_map.z[1][13] = 60.0;
+    table_set(&torque_map, 0, 0, -50.0);
+    table_set(&torque_map, 0, 1, -53.1415926535898);
+    table_set(&torque_map, 0, 2, -53.1415926535898);
+    table_set(&torque_map, 0, 3, -56.283185307179586);
+    table_set(&torque_map, 0, 4, -59.424777960769376);
+    table_set(&torque_map, 0, 5, -62.56637061435917);
+    table_set(&torque_map, 0, 6, -65.70796326794897);
+    table_set(&torque_map, 0, 7, -68.84955592153875);
+    table_set(&torque_map, 0, 8, -71.99114857512855);
+    table_set(&torque_map, 0, 9, -75.13274122871834);
+    table_set(&torque_map, 0, 10, -78.27433388230814);
+    table_set(&torque_map, 0, 11, -81.41592653589794);
+    table_set(&torque_map, 0, 12, -84.55751918948772);
+    table_set(&torque_map, 0, 13, -87.69911184307752);
+    table_set(&torque_map, 1, 0, -50.0);
+    table_set(&torque_map, 1, 1, -53.1415926535898);
+    table_set(&torque_map, 1, 2, 15.0);
+    table_set(&torque_map, 1, 3, 60.0);
+    table_set(&torque_map, 1, 4, 90.0);
+    table_set(&torque_map, 1, 5, 120.0);
+    table_set(&torque_map, 1, 6, 142.5);
+    table_set(&torque_map, 1, 7, 150.0);
+    table_set(&torque_map, 1, 8, 148.5);
+    table_set(&torque_map, 1, 9, 139.5);
+    table_set(&torque_map, 1, 10, 127.5);
+    table_set(&torque_map, 1, 11, 112.5);
+    table_set(&torque_map, 1, 12, 90.0);
+    table_set(&torque_map, 1, 13, 60.0);
 
     return engine_new(0.5, torque_map);
 }
@@ -77,4 +78,71 @@ Gearbox* test_gearbox(void)
     return gearbox_new(ratios, inertias);
 }
 
+TireModel test_tire_model(void)
+{
+    return (TireModel) {
+        .bx = 11.0,
+        .by = 8.0,
+        .cx = 1.65,
+        .cy = 1.36,
+        .dx = 1.05,
+        .dy = 1.0,
+        .ex = 0.6,
+        .ey = 0.7,
+        .peak_slip_x = 0.18,
+        .peak_slip_y = deg_to_rad(30.0f),
+    };
+}
+
+/** The car of main.c */
+raVehicleParams test_vehicle_params(const TireModel* model)
+{
+    Caliper front = caliper_new(cylinder_from_diameter(0.05), 0.25, 2);
+    Caliper rear = caliper_new(cylinder_from_diameter(0.05), 0.26, 2);
+    Abs abs = abs_new(-0.18, 2.0);
+    return (raVehicleParams) {
+        .body = body_new(0.36, 0.1, 0.07, 1.9, 3.6f, 1.47f, 1.475f),
+        .mass = 1580.0f,
+        .i_zz = 2600.0,
+        .gravity = 9.806f,
+        .air_density = 1.2041f,
+        .steering_ratio = 1.0 / 16.0,
+        .idle_velocity = rpm_to_rads(850.0),
+        .master_cylinder = master_cylinder_new(10000e3),
+        .brake_disc = brake_disc_new(0.3, 0.24),
+        .calipers = { front, front, rear, rear },
+        .abs = { abs, abs, abs, abs },
+        .friction = { 1.0, 1.0, 1.0, 1.0 },
+        .tire_model = model,
+    };
+}
+
+raVehicleParts test_vehicle_parts(const raVehicleParams* params)
+{
+    Cog cog = cog_from_distribution(0.55, 0.4, params->body.wheelbase);
+    float front = cog_distance_to_front(cog);
+    float rear = cog_distance_to_rear(cog, params->body.wheelbase);
+    Vector2f positions[RA_VEHICLE_NUM_WHEELS] = {
+        { .x = front, .y = cog_distance_to_left(cog, params->body.front_track_width) },
+        { .x = front, .y = cog_distance_to_right(cog, params->body.front_track_width) },
+        { .x = rear, .y = cog_distance_to_left(cog, params->body.rear_track_width) },
+        { .x = rear, .y = cog_distance_to_right(cog, params->body.rear_track_width) },
+    };
+
+    raVehicleParts parts = {
+        .engine = test_engine(),
+        .rev_limiter = rev_limiter_hard_new(rpm_to_rads(4800.0), rpm_to_rads(4650.0)),
+        .gearbox = test_gearbox(),
+        .differential = differential_new(2.4, 0.18, DiffTypeLocked),
+    };
+    parts.engine->angular_velocity = rpm_to_rads(1200.0);
+    parts.clutch = clutch_with_torque(&parts.clutch_normal_force, 300.0, 240.0);
+    parts.gearbox->curr_gear = 1;
+    for (int i = 0; i < RA_VEHICLE_NUM_WHEELS; i++) {
+        parts.wheels[i] = wheel_new(0.6, 0.344, positions[i], 0.01);
+    }
+
+    return parts;
+}
+
 #endif // RA_TEST_TEST_H
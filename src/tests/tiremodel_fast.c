@@ -0,0 +1,47 @@
+#include "../tiremodel.h"
+#include "test.h"
+#include <assert.h>
+#include <math.h>
+
+static float max_error(float c, float d, float e)
+{
+    return fabsf(d)
+        * (RA_TIREMODEL_FAST_SIN_MAX_ERROR
+            + fabsf(c) * (1.0f + fabsf(e)) * RA_TIREMODEL_FAST_ATAN_MAX_ERROR)
+        // Rounding in the remaining arithmetic
+        + fabsf(d) * 1e-6f;
+}
+
+int main(void)
+{
+    TireModel exact = test_tire_model();
+    TireModel fast = exact;
+    fast.accuracy = TireModelAccuracyFast;
+
+    float normal_force = 4000.0;
+    float friction = 1.1;
+    float error_x = max_error(exact.cx, exact.dx * normal_force * friction, exact.ex);
+    float error_y = max_error(exact.cy, exact.dy * normal_force * friction, exact.ey);
+
+    // Pure and combined slip, from locked to spinning and up to sliding sideways
+    for (int i = -200; i <= 200; i++) {
+        float ratio = (float)i * 0.005f;
+        for (int j = -180; j <= 180; j++) {
+            float angle = deg_to_rad((float)j * 0.5f);
+            Vector2f e = tiremodel_force(&exact, normal_force, ratio, angle, friction);
+            Vector2f f = tiremodel_force(&fast, normal_force, ratio, angle, friction);
+            assert(fabsf(e.x - f.x) <= error_x);
+            assert(fabsf(e.y - f.y) <= error_y);
+        }
+    }
+
+    // Far outside the normal range
+    for (int i = -100; i <= 100; i++) {
+        float slip = (float)i * 0.5f;
+        Vector2f e = tiremodel_force(&exact, normal_force, slip, 0.0, friction);
+        Vector2f f = tiremodel_force(&fast, normal_force, slip, 0.0, friction);
+        assert(fabsf(e.x - f.x) <= error_x);
+    }
+
+    return 0;
+}
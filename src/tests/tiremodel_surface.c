@@ -0,0 +1,54 @@
+#include "../tiremodel.h"
+#include "test.h"
+#include <assert.h>
+#include <math.h>
+#include <stddef.h>
+
+int main(void)
+{
+    TireModel exact = test_tire_model();
+    exact.vvx = 20.0;
+    exact.vvy = -10.0;
+
+    TireModel model = exact;
+    TireSurfaceConfig config = tire_surface_config_default();
+    config.max_error = 5e-3;
+    tiremodel_enable_surface(&model, &ra_heap_allocator, config);
+    assert(!model.surface->is_built);
+
+    float normal_force = 4000.0;
+    float friction = 1.1;
+    float d = normal_force * friction;
+
+    // Pure slip is not covered by the surface
+    Vector2f pure = tiremodel_force(&model, normal_force, 0.1, 0.0, friction);
+    assert(!model.surface->is_built);
+    Vector2f pure_exact = tiremodel_force(&exact, normal_force, 0.1, 0.0, friction);
+    assert(pure.x == pure_exact.x && pure.y == pure_exact.y);
+
+    tiremodel_force(&model, normal_force, 0.1, 0.1, friction);
+    assert(model.surface->is_built);
+    assert(model.surface->error <= config.max_error);
+
+    // The error is estimated from a few points per cell, allow some slack in between them
+    for (int i = -250; i <= 250; i++) {
+        float ratio = (float)i * 0.002f;
+        for (int j = -100; j <= 100; j++) {
+            float angle = (float)j * 0.005f;
+            Vector2f e = tiremodel_force(&exact, normal_force, ratio, angle, friction);
+            Vector2f s = tiremodel_force(&model, normal_force, ratio, angle, friction);
+            assert(fabsf(e.x - s.x) <= 2.0f * config.max_error * exact.dx * d);
+            assert(fabsf(e.y - s.y) <= 2.0f * config.max_error * exact.dy * d);
+        }
+    }
+
+    // Outside of the surface
+    Vector2f outside = tiremodel_force(&model, normal_force, 0.9, 0.2, friction);
+    Vector2f outside_exact = tiremodel_force(&exact, normal_force, 0.9, 0.2, friction);
+    assert(outside.x == outside_exact.x && outside.y == outside_exact.y);
+
+    tiremodel_disable_surface(&model);
+    assert(model.surface == NULL);
+
+    return 0;
+}
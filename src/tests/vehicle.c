@@ -0,0 +1,112 @@
+#include "../vehicle.h"
+#include "test.h"
+#include <assert.h>
+#include <string.h>
+
+static bool same(float a, float b) { return memcmp(&a, &b, sizeof a) == 0; }
+
+/** Launches, shifts up and brakes, with inputs that depend on `seed` */
+static raInputs inputs(int step, float seed)
+{
+    float t = (float)step / 200.0f;
+    return (raInputs) {
+        .throttle = step < 1200 ? 0.7f + 0.1f * seed : 0.0f,
+        .brake = step < 1200 ? 0.0f : 0.8f,
+        .clutch = fmaxf(0.0f, 1.0f - t * t * 0.09f),
+        .steering = deg_to_rad(10.0f * seed) * sinf(t),
+    };
+}
+
+/** Drives straight like main.c, brakes to a stop and holds the car there for `hold` seconds.
+ * Driving straight must not make the car drift or turn. */
+static void stop_and_hold(const raVehicleParams* params, float hold)
+{
+    raVehicle v;
+    assert(ra_vehicle_init(&v, params, test_vehicle_parts(params)) == 0);
+
+    raInputs in = { .throttle = 1.0f, .brake = 0.0f, .clutch = 1.0f, .steering = 0.0f };
+    float dt = 1.0f / 200.0f;
+    float t = 0.0f;
+    float stopped = -1.0f;
+    while (stopped < 0.0f || t < stopped + hold) {
+        if (in.brake == 0.0f && v.velocity.x >= 16.0f) {
+            in.throttle = 0.0f;
+            in.brake = 1.0f;
+        } else if (in.brake == 0.0f) {
+            in.clutch = fminf(1.0f, fmaxf(0.0f, 1.0f - t * t * 0.09f));
+        } else if (v.engine->angular_velocity <= params->idle_velocity) {
+            in.clutch = 1.0f;
+        }
+
+        ra_vehicle_step(&v, &in, dt);
+        t += dt;
+        if (stopped < 0.0f && in.brake == 1.0f && v.velocity.x < 0.05f) {
+            stopped = t;
+        }
+
+        assert(v.velocity.y == 0.0f && v.yaw_velocity == 0.0f);
+        assert(same(v.wheels[raVehicleWheelRl]->angular_velocity,
+            v.wheels[raVehicleWheelRr]->angular_velocity));
+        assert(t < 60.0f);
+    }
+
+    // Held in place
+    assert(v.velocity.x < 0.05f);
+    ra_vehicle_free(&v);
+}
+
+int main(void)
+{
+    TireModel model = test_tire_model();
+    raVehicleParams params = test_vehicle_params(&model);
+
+    // A wheel can only be used once
+    raVehicleParts parts = test_vehicle_parts(&params);
+    Wheel* fr = parts.wheels[1];
+    parts.wheels[1] = parts.wheels[0];
+    raVehicle v;
+    assert(ra_vehicle_init(&v, &params, parts) == RaErrorTaggedSame);
+    parts.wheels[1] = fr;
+
+    raVehicle alone, a, b;
+    assert(ra_vehicle_init(&v, &params, parts) == 0);
+    assert(ra_vehicle_init(&alone, &params, test_vehicle_parts(&params)) == 0);
+    assert(ra_vehicle_init(&a, &params, test_vehicle_parts(&params)) == 0);
+    assert(ra_vehicle_init(&b, &params, test_vehicle_parts(&params)) == 0);
+    ra_vehicle_free(&v);
+
+    // Stepping vehicles in turn gives the same as stepping one alone
+    float dt = 1.0f / 200.0f;
+    for (int step = 0; step < 2000; step++) {
+        if (step == 600) {
+            gearbox_upshift(alone.gearbox);
+            gearbox_upshift(a.gearbox);
+        }
+
+        raInputs in = inputs(step, 1.0f);
+        raInputs other = inputs(step, -0.5f);
+        ra_vehicle_step(&alone, &in, dt);
+        ra_vehicle_step(&a, &in, dt);
+        ra_vehicle_step(&b, &other, dt);
+
+        assert(same(a.velocity.x, alone.velocity.x) && same(a.velocity.y, alone.velocity.y));
+        assert(same(a.yaw_velocity, alone.yaw_velocity));
+        assert(same(a.engine->angular_velocity, alone.engine->angular_velocity));
+        for (int i = 0; i < RA_VEHICLE_NUM_WHEELS; i++) {
+            assert(same(a.wheels[i]->angular_velocity, alone.wheels[i]->angular_velocity));
+        }
+    }
+
+    // It drove off, turned and came to a stop
+    assert(alone.gearbox->curr_gear == 2);
+    assert(alone.position.x > 10.0f && alone.rotation != 0.0f);
+    assert(alone.velocity.x < 1.0f);
+    assert(!same(b.position.y, alone.position.y));
+
+    ra_vehicle_free(&alone);
+    ra_vehicle_free(&a);
+    ra_vehicle_free(&b);
+
+    stop_and_hold(&params, 10.0f);
+    return 0;
+}
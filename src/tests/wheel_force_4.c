@@ -0,0 +1,71 @@
+#include "../wheel.h"
+#include "test.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static float random_range(float low, float high)
+{
+    return low + (high - low) * (float)rand() / (float)RAND_MAX;
+}
+
+static bool same(float a, float b) { return memcmp(&a, &b, sizeof a) == 0; }
+
+int main(void)
+{
+    TireModel model = test_tire_model();
+
+    Wheel* wheels[4];
+    Wheel* scalar[4];
+    for (int l = 0; l < 4; l++) {
+        wheels[l] = wheel_new(0.6, 0.344, vector2f_default(), 0.1);
+        scalar[l] = wheel_new(0.6, 0.344, vector2f_default(), 0.1);
+    }
+
+    srand(3);
+    TireModelAccuracy accuracies[] = { TireModelAccuracyExact, TireModelAccuracyFast };
+    for (size_t a = 0; a < 2; a++) {
+        model.accuracy = accuracies[a];
+
+        for (int n = 0; n < 20000; n++) {
+            float fz[4], mu[4];
+            for (int l = 0; l < 4; l++) {
+                Wheel* w = wheels[l];
+                w->hub_velocity.x = random_range(-40.0, 40.0);
+                w->hub_velocity.y = random_range(-5.0, 5.0);
+                w->angular_velocity = w->hub_velocity.x / w->effective_radius;
+                w->angle = random_range(-0.5, 0.5);
+                fz[l] = random_range(1000.0, 6000.0);
+                mu[l] = random_range(0.6, 1.2);
+
+                // Covers free rolling, pure slip in either direction and combined slip
+                int kind = rand() % 4;
+                if (kind == 1 || kind == 3) {
+                    w->angular_velocity *= random_range(0.0, 2.0);
+                }
+                if (kind < 2) {
+                    w->hub_velocity.y = w->hub_velocity.x * tanf(w->angle);
+                }
+
+                *scalar[l] = *w;
+            }
+
+            Vector2f force[4];
+            wheel_force_4(wheels, &model, fz, mu, force);
+
+            for (int l = 0; l < 4; l++) {
+                Vector2f f = vector2f_rotate(
+                    wheel_force(scalar[l], &model, fz[l], mu[l]), -scalar[l]->angle);
+                assert(same(force[l].x, f.x) && same(force[l].y, f.y));
+                assert(same(wheels[l]->reaction_torque, scalar[l]->reaction_torque));
+            }
+        }
+    }
+
+    for (int l = 0; l < 4; l++) {
+        free(wheels[l]);
+        free(scalar[l]);
+    }
+
+    return 0;
+}
@@ -1,5 +1,8 @@
 #include "tiremodel.h"
+#include "simd.h"
+#include <assert.h>
 #include <math.h>
+#include <stdbool.h>
 
 static inline float thread_velocity(float angular_velocity, float effective_radius)
 {
@@ -16,34 +19,362 @@ float slip_ratio(Vector2f velocity, float angular_velocity, float effective_radi
     return slip_velocity / (fmaxf(fabsf(velocity.x), fabsf(thread_vel)));
 }
 
-static float pacejka(float b, float c, float d, float e, float vh, float vv, float slip)
+/** Abramowitz and Stegun 4.4.47 on [-1, 1], and atan(x) = pi/2 - atan(1/x) outside of it */
+static inline float fast_atanf(float x)
+{
+    float a = fabsf(x);
+    bool inverted = a > 1.0f;
+    float t = inverted ? 1.0f / a : a;
+    float t2 = t * t;
+    float r = t
+        * (0.9998660f
+            + t2 * (-0.3302995f + t2 * (0.1801410f + t2 * (-0.0851330f + t2 * 0.0208351f))));
+
+    return copysignf(inverted ? (float)M_PI / 2.0f - r : r, x);
+}
+
+/** Reduced to [-pi/2, pi/2] where Abramowitz and Stegun 4.3.97 is used */
+static inline float fast_sinf(float x)
+{
+    float turns = x * (0.5f / (float)M_PI);
+    x -= (float)(int)(turns + (turns >= 0.0f ? 0.5f : -0.5f)) * (2.0f * (float)M_PI);
+    if (x > (float)M_PI / 2.0f) {
+        x = (float)M_PI - x;
+    } else if (x < -(float)M_PI / 2.0f) {
+        x = -(float)M_PI - x;
+    }
+
+    float x2 = x * x;
+    return x
+        * (1.0f
+            + x2
+                * (-0.1666666664f
+                    + x2
+                        * (0.0083333315f
+                            + x2 * (-0.0001984090f + x2 * (0.0000027526f - x2 * 0.0000000239f)))));
+}
+
+static inline float pacejka(
+    float b, float c, float d, float e, float vh, float vv, float slip, bool fast)
 {
     float b1 = b * (slip + vh);
+    if (fast) {
+        return d * fast_sinf(c * fast_atanf(b1 - e * (b1 - fast_atanf(b1)))) + vv;
+    }
+
     return d * sinf(c * atanf(b1 - e * (b1 - atanf(b1)))) + vv;
 }
 
+static Vector2f combined_force(const TireModel* m, float dx_inf, float dy_inf, float vvx, float vvy,
+    float slip_ratio, float slip_angle)
+{
+    bool fast = m->accuracy == TireModelAccuracyFast;
+    float norm_slip_x = slip_ratio / m->peak_slip_x;
+    float norm_slip_y = slip_angle / m->peak_slip_y;
+
+    float norm_slip = sqrtf(norm_slip_x * norm_slip_x + norm_slip_y * norm_slip_y);
+    float fx0 = pacejka(m->bx, m->cx, dx_inf, m->ex, m->vhx, vvx, norm_slip, fast);
+    float fy0 = pacejka(m->by, m->cy, dy_inf, m->ey, m->vhy, vvy, norm_slip, fast);
+    float fx = (norm_slip_x / norm_slip) * fx0;
+    float fy = (norm_slip_y / norm_slip) * fy0;
+
+    return (Vector2f) { .x = fx, .y = -fy };
+}
+
+static bool is_combined_slip(float slip_ratio, float slip_angle)
+{
+    return fabsf(slip_ratio) > EPSILON && fabsf(slip_angle) > EPSILON;
+}
+
+static Vector2f formula_force(const TireModel* m, float dx_inf, float dy_inf, float vvx, float vvy,
+    float slip_ratio, float slip_angle)
+{
+    if (is_combined_slip(slip_ratio, slip_angle)) {
+        return combined_force(m, dx_inf, dy_inf, vvx, vvy, slip_ratio, slip_angle);
+    }
+
+    // Pure slip scenario
+    bool fast = m->accuracy == TireModelAccuracyFast;
+    float fx = pacejka(m->bx, m->cx, dx_inf, m->ex, m->vhx, vvx, slip_ratio, fast);
+    float fy = pacejka(m->by, m->cy, dy_inf, m->ey, m->vhy, vvy, slip_angle, fast);
+
+    return (Vector2f) { .x = fx, .y = -fy };
+}
+
+/** The combined slip force for D = 1 that the surface is sampled from. Pure slip uses the
+ * unnormalized slip and so does not continue the combined force smoothly, which is why the
+ * surface only replaces the combined case. */
+static Vector2f surface_sample(const TireModel* m, float slip_ratio, float slip_angle)
+{
+    if (slip_ratio == 0.0f && slip_angle == 0.0f) {
+        return (Vector2f) { .x = 0.0f, .y = 0.0f };
+    }
+
+    return combined_force(m, 1.0f, 1.0f, 0.0f, 0.0f, slip_ratio, slip_angle);
+}
+
+TireSurfaceConfig tire_surface_config_default(void)
+{
+    return (TireSurfaceConfig) {
+        .max_slip_ratio = 0.5,
+        .max_slip_angle = 0.5,
+        .slip_ratio_elements = 64,
+        .slip_angle_elements = 64,
+        .max_error = 2e-3,
+        .max_elements = 2048,
+    };
+}
+
+void tiremodel_enable_surface(TireModel* m, raAllocator* a, TireSurfaceConfig config)
+{
+    assert(config.slip_ratio_elements >= 2 && config.slip_angle_elements >= 2);
+    tiremodel_disable_surface(m);
+
+    m->surface = ra_alloc(a, sizeof *m->surface);
+    *m->surface = (TireSurface) { .config = config, .is_built = false, .allocator = a };
+}
+
+static float sample_error(const TireSurface* s, Vector2f exact, float slip_ratio, float slip_angle)
+{
+    float ex = fabsf(table_lookup(&s->fx, slip_ratio, slip_angle) - exact.x);
+    float ey = fabsf(table_lookup(&s->fy, slip_ratio, slip_angle) - exact.y);
+    return fmaxf(ex, ey);
+}
+
+/** Bilinear interpolation is exact on the breakpoints, so the error is largest in between them.
+ * The error halfway along the slip ratio edges of the cells is mostly down to the slip ratio
+ * spacing and the other way around, the cell centers depend on both. */
+static void surface_error(
+    const TireModel* m, const TireSurface* s, float* along_x, float* along_y, float* center)
+{
+    const Table* t = &s->fx;
+    *along_x = 0.0f;
+    *along_y = 0.0f;
+    *center = 0.0f;
+    for (size_t i = 0; i + 1 < t->x_capacity; i++) {
+        for (size_t j = 0; j + 1 < t->y_capacity; j++) {
+            float xm = (t->x[i] + t->x[i + 1]) * 0.5f;
+            float ym = (t->y[j] + t->y[j + 1]) * 0.5f;
+            float x = t->x[i];
+            float y = t->y[j];
+            *along_x = fmaxf(*along_x, sample_error(s, surface_sample(m, xm, y), xm, y));
+            *along_y = fmaxf(*along_y, sample_error(s, surface_sample(m, x, ym), x, ym));
+            *center = fmaxf(*center, sample_error(s, surface_sample(m, xm, ym), xm, ym));
+        }
+    }
+}
+
+void tiremodel_build_surface(const TireModel* m)
+{
+    TireSurface* s = m->surface;
+    if (s == NULL || s->is_built) {
+        return;
+    }
+
+    const TireSurfaceConfig* c = &s->config;
+    size_t nx = c->slip_ratio_elements;
+    size_t ny = c->slip_angle_elements;
+
+    for (;;) {
+        s->fx = table_uniform_with_capacity_in(s->allocator, nx, -c->max_slip_ratio,
+            c->max_slip_ratio, ny, -c->max_slip_angle, c->max_slip_angle);
+        s->fy = table_uniform_with_capacity_in(s->allocator, nx, -c->max_slip_ratio,
+            c->max_slip_ratio, ny, -c->max_slip_angle, c->max_slip_angle);
+
+        for (size_t i = 0; i < nx; i++) {
+            for (size_t j = 0; j < ny; j++) {
+                Vector2f f = surface_sample(m, s->fx.x[i], s->fx.y[j]);
+                table_set(&s->fx, i, j, f.x);
+                table_set(&s->fy, i, j, f.y);
+            }
+        }
+
+        float along_x, along_y, center;
+        surface_error(m, s, &along_x, &along_y, &center);
+        s->error = fmaxf(center, fmaxf(along_x, along_y));
+        if (s->error <= c->max_error) {
+            break;
+        }
+
+        // Only refines the axes that need it, the slip ratio usually needs a lot more breakpoints
+        bool refine_x = along_x > c->max_error || (center > c->max_error && along_y <= along_x);
+        bool refine_y = along_y > c->max_error || (center > c->max_error && along_x <= along_y);
+        size_t next_nx = refine_x && nx * 2 <= c->max_elements ? nx * 2 : nx;
+        size_t next_ny = refine_y && ny * 2 <= c->max_elements ? ny * 2 : ny;
+        if (next_nx == nx && next_ny == ny) {
+            break;
+        }
+
+        table_free(&s->fx);
+        table_free(&s->fy);
+        nx = next_nx;
+        ny = next_ny;
+    }
+
+    s->is_built = true;
+}
+
+void tiremodel_disable_surface(TireModel* m)
+{
+    if (m->surface == NULL) {
+        return;
+    }
+
+    if (m->surface->is_built) {
+        table_free(&m->surface->fx);
+        table_free(&m->surface->fy);
+    }
+
+    ra_free(m->surface->allocator, m->surface);
+    m->surface = NULL;
+}
+
+static Vector2f surface_force(
+    const TireModel* m, float dx_inf, float dy_inf, float slip_ratio, float slip_angle)
+{
+    const TireSurface* s = m->surface;
+    float fx = dx_inf * table_lookup(&s->fx, slip_ratio, slip_angle);
+    float fy = dy_inf * table_lookup(&s->fy, slip_ratio, slip_angle);
+
+    // The vertical offset does not scale with D, so it is added separately
+    if (m->vvx != 0.0f || m->vvy != 0.0f) {
+        Vector2f offset = combined_force(m, 0.0f, 0.0f, m->vvx, m->vvy, slip_ratio, slip_angle);
+        fx += offset.x;
+        fy += offset.y;
+    }
+
+    return (Vector2f) { .x = fx, .y = fy };
+}
+
 Vector2f tiremodel_force(const TireModel* m, float normal_force, float slip_ratio, float slip_angle,
     float friction_coefficent)
 {
     float dx_inf = m->dx * normal_force * friction_coefficent;
     float dy_inf = m->dy * normal_force * friction_coefficent;
 
-    float fx, fy;
-    if (fabsf(slip_ratio) > EPSILON && fabsf(slip_angle) > EPSILON) {
-        // Combined slip
-        float norm_slip_x = slip_ratio / m->peak_slip_x;
-        float norm_slip_y = slip_angle / m->peak_slip_y;
-
-        float norm_slip = sqrtf(norm_slip_x * norm_slip_x + norm_slip_y * norm_slip_y);
-        float fx0 = pacejka(m->bx, m->cx, dx_inf, m->ex, m->vhx, m->vvx, norm_slip);
-        float fy0 = pacejka(m->by, m->cy, dy_inf, m->ey, m->vhy, m->vvy, norm_slip);
-        fx = (norm_slip_x / norm_slip) * fx0;
-        fy = (norm_slip_y / norm_slip) * fy0;
+    if (m->surface != NULL && is_combined_slip(slip_ratio, slip_angle)
+        && fabsf(slip_ratio) <= m->surface->config.max_slip_ratio
+        && fabsf(slip_angle) <= m->surface->config.max_slip_angle) {
+        tiremodel_build_surface(m);
+        return surface_force(m, dx_inf, dy_inf, slip_ratio, slip_angle);
+    }
+
+    return formula_force(m, dx_inf, dy_inf, m->vvx, m->vvy, slip_ratio, slip_angle);
+}
+
+// The vector versions below are the same single precision operations in the same order as the
+// scalar ones, so each lane gives exactly the same result as tiremodel_force.
+
+#ifdef RA_SIMD_X86
+static inline __m128 sign_bit_sse(void) { return _mm_set1_ps(-0.0f); }
+
+static inline __m128 fast_atanf_sse(__m128 x)
+{
+    __m128 a = _mm_andnot_ps(sign_bit_sse(), x);
+    __m128 inverted = _mm_cmpgt_ps(a, _mm_set1_ps(1.0f));
+    __m128 t = ra_simd_select(inverted, _mm_div_ps(_mm_set1_ps(1.0f), a), a);
+    __m128 t2 = _mm_mul_ps(t, t);
+
+    __m128 p = _mm_add_ps(_mm_set1_ps(-0.0851330f), _mm_mul_ps(t2, _mm_set1_ps(0.0208351f)));
+    p = _mm_add_ps(_mm_set1_ps(0.1801410f), _mm_mul_ps(t2, p));
+    p = _mm_add_ps(_mm_set1_ps(-0.3302995f), _mm_mul_ps(t2, p));
+    p = _mm_add_ps(_mm_set1_ps(0.9998660f), _mm_mul_ps(t2, p));
+    __m128 r = _mm_mul_ps(t, p);
+
+    r = ra_simd_select(inverted, _mm_sub_ps(_mm_set1_ps((float)M_PI / 2.0f), r), r);
+    return _mm_or_ps(_mm_andnot_ps(sign_bit_sse(), r), _mm_and_ps(sign_bit_sse(), x));
+}
+
+static inline __m128 fast_sinf_sse(__m128 x)
+{
+    __m128 turns = _mm_mul_ps(x, _mm_set1_ps(0.5f / (float)M_PI));
+    __m128 half = ra_simd_select(_mm_cmpge_ps(turns, _mm_setzero_ps()), _mm_set1_ps(0.5f),
+        _mm_set1_ps(-0.5f));
+    __m128 k = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_add_ps(turns, half)));
+    x = _mm_sub_ps(x, _mm_mul_ps(k, _mm_set1_ps(2.0f * (float)M_PI)));
+
+    __m128 above = _mm_cmpgt_ps(x, _mm_set1_ps((float)M_PI / 2.0f));
+    __m128 below = _mm_cmplt_ps(x, _mm_set1_ps(-(float)M_PI / 2.0f));
+    x = ra_simd_select(above, _mm_sub_ps(_mm_set1_ps((float)M_PI), x),
+        ra_simd_select(below, _mm_sub_ps(_mm_set1_ps(-(float)M_PI), x), x));
+
+    __m128 x2 = _mm_mul_ps(x, x);
+    __m128 p = _mm_sub_ps(_mm_set1_ps(0.0000027526f), _mm_mul_ps(x2, _mm_set1_ps(0.0000000239f)));
+    p = _mm_add_ps(_mm_set1_ps(-0.0001984090f), _mm_mul_ps(x2, p));
+    p = _mm_add_ps(_mm_set1_ps(0.0083333315f), _mm_mul_ps(x2, p));
+    p = _mm_add_ps(_mm_set1_ps(-0.1666666664f), _mm_mul_ps(x2, p));
+    p = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(x2, p));
+    return _mm_mul_ps(x, p);
+}
+
+static inline __m128 pacejka_sse(
+    float b, float c, __m128 d, float e, float vh, float vv, __m128 slip, bool fast)
+{
+    __m128 b1 = _mm_mul_ps(_mm_set1_ps(b), _mm_add_ps(slip, _mm_set1_ps(vh)));
+    __m128 ve = _mm_set1_ps(e);
+    __m128 vc = _mm_set1_ps(c);
+    __m128 s;
+    if (fast) {
+        __m128 inner = _mm_sub_ps(b1, _mm_mul_ps(ve, _mm_sub_ps(b1, fast_atanf_sse(b1))));
+        s = fast_sinf_sse(_mm_mul_ps(vc, fast_atanf_sse(inner)));
     } else {
-        // Pure slip scenario
-        fx = pacejka(m->bx, m->cx, dx_inf, m->ex, m->vhx, m->vvx, slip_ratio);
-        fy = pacejka(m->by, m->cy, dy_inf, m->ey, m->vhy, m->vvy, slip_angle);
+        __m128 inner = _mm_sub_ps(b1, _mm_mul_ps(ve, _mm_sub_ps(b1, ra_simd_map(atanf, b1))));
+        s = ra_simd_map(sinf, _mm_mul_ps(vc, ra_simd_map(atanf, inner)));
     }
 
-    return (Vector2f) { .x = fx, .y = -fy };
+    return _mm_add_ps(_mm_mul_ps(d, s), _mm_set1_ps(vv));
+}
+
+static void tiremodel_force_sse(const TireModel* m, const float normal_force[4],
+    const float slip_ratio[4], const float slip_angle[4], const float friction_coefficent[4],
+    float force_x[4], float force_y[4])
+{
+    bool fast = m->accuracy == TireModelAccuracyFast;
+    __m128 nf = _mm_loadu_ps(normal_force);
+    __m128 mu = _mm_loadu_ps(friction_coefficent);
+    __m128 dx_inf = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(m->dx), nf), mu);
+    __m128 dy_inf = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(m->dy), nf), mu);
+
+    __m128 sx = _mm_loadu_ps(slip_ratio);
+    __m128 sy = _mm_loadu_ps(slip_angle);
+    __m128 eps = _mm_set1_ps((float)EPSILON);
+    __m128 combined = _mm_and_ps(_mm_cmpgt_ps(_mm_andnot_ps(sign_bit_sse(), sx), eps),
+        _mm_cmpgt_ps(_mm_andnot_ps(sign_bit_sse(), sy), eps));
+
+    __m128 norm_slip_x = _mm_div_ps(sx, _mm_set1_ps(m->peak_slip_x));
+    __m128 norm_slip_y = _mm_div_ps(sy, _mm_set1_ps(m->peak_slip_y));
+    __m128 norm_slip = _mm_sqrt_ps(_mm_add_ps(
+        _mm_mul_ps(norm_slip_x, norm_slip_x), _mm_mul_ps(norm_slip_y, norm_slip_y)));
+
+    // Pure slip lanes evaluate the formula at their own slip instead of the combined one
+    __m128 fx0 = pacejka_sse(m->bx, m->cx, dx_inf, m->ex, m->vhx, m->vvx,
+        ra_simd_select(combined, norm_slip, sx), fast);
+    __m128 fy0 = pacejka_sse(m->by, m->cy, dy_inf, m->ey, m->vhy, m->vvy,
+        ra_simd_select(combined, norm_slip, sy), fast);
+    __m128 fx = ra_simd_select(combined, _mm_mul_ps(_mm_div_ps(norm_slip_x, norm_slip), fx0), fx0);
+    __m128 fy = ra_simd_select(combined, _mm_mul_ps(_mm_div_ps(norm_slip_y, norm_slip), fy0), fy0);
+
+    _mm_storeu_ps(force_x, fx);
+    _mm_storeu_ps(force_y, _mm_xor_ps(fy, sign_bit_sse()));
+}
+#endif
+
+void tiremodel_force_4(const TireModel* m, const float normal_force[4], const float slip_ratio[4],
+    const float slip_angle[4], const float friction_coefficent[4], float force_x[4],
+    float force_y[4])
+{
+#ifdef RA_SIMD_X86
+    if (m->surface == NULL) {
+        tiremodel_force_sse(
+            m, normal_force, slip_ratio, slip_angle, friction_coefficent, force_x, force_y);
+        return;
+    }
+#endif
+
+    for (int l = 0; l < 4; l++) {
+        Vector2f f = tiremodel_force(
+            m, normal_force[l], slip_ratio[l], slip_angle[l], friction_coefficent[l]);
+        force_x[l] = f.x;
+        force_y[l] = f.y;
+    }
 }
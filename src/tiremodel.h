@@ -2,6 +2,50 @@
 #define RA_TIREMODEL_H
 #include "common.h"
 
+/** Upper bounds of the absolute error of the approximations used by `TireModelAccuracyFast`. The
+ * sine bound holds for arguments within +-20 radians, far outside of what the model produces. */
+#define RA_TIREMODEL_FAST_ATAN_MAX_ERROR 1.2e-5f
+#define RA_TIREMODEL_FAST_SIN_MAX_ERROR 5e-7f
+
+typedef enum {
+    /** Uses atanf and sinf from libm */
+    TireModelAccuracyExact,
+    /** Uses polynomial approximations of atan and sin. The force from each evaluation of the
+     * magic formula is off by at most
+     * |D| * (RA_TIREMODEL_FAST_SIN_MAX_ERROR + |C| * (1 + |E|) * RA_TIREMODEL_FAST_ATAN_MAX_ERROR)
+     * where D is the peak after scaling by normal force and friction. */
+    TireModelAccuracyFast,
+} TireModelAccuracy;
+
+/** Settings for the precomputed force surface. See `tiremodel_enable_surface` */
+typedef struct {
+    /** The surface covers slip ratios and slip angles within +-these. Slip outside of it is
+     * evaluated with the formula */
+    float max_slip_ratio, max_slip_angle;
+    /** Number of breakpoints along each axis to start with */
+    size_t slip_ratio_elements, slip_angle_elements;
+    /** Largest allowed interpolation error as a fraction of the peak force D. The number of
+     * breakpoints is doubled until the error is below it or an axis would exceed
+     * `max_elements` */
+    float max_error;
+    size_t max_elements;
+} TireSurfaceConfig;
+
+/** The combined slip force for a peak force of 1 and no vertical offset, sampled on a uniform
+ * grid */
+typedef struct {
+    TireSurfaceConfig config;
+    bool is_built;
+    /** x is slip ratio, y is slip angle */
+    Table fx, fy;
+    /** Largest error found when building, as a fraction of D */
+    float error;
+    /** What the surface and its tables are allocated with */
+    raAllocator* allocator;
+} TireSurface;
+
+TireSurfaceConfig tire_surface_config_default(void);
+
 // TODO: Add alignment moment
 /** *x = longitudinal, *y = lateral *mz = alignment moment */
 typedef struct {
@@ -20,6 +64,10 @@ typedef struct {
     float vhx, vhy;
 
     float peak_slip_x, peak_slip_y;
+    /** Defaults to `TireModelAccuracyExact` when zero initialized */
+    TireModelAccuracy accuracy;
+    /** Optional, see `tiremodel_enable_surface` */
+    TireSurface* surface;
 } TireModel;
 
 float slip_angle(Vector2f velocity, float angle);
@@ -27,5 +75,23 @@ float slip_ratio(Vector2f velocity, float angular_velocity, float effective_radi
 
 Vector2f tiremodel_force(const TireModel* m, float normal_force, float slip_ratio, float slip_angle,
     float friction_coefficent);
+/** Makes `tiremodel_force` bilinearly interpolate a precomputed surface instead of evaluating the
+ * formula. The surface is built from the current coefficients and accuracy on the first call
+ * that needs it, the coefficients must not change afterwards. The force is off by at most
+ * `config.max_error` * D, or `surface->error` * D if the resolution limit was hit first. */
+void tiremodel_enable_surface(TireModel* m, raAllocator* a, TireSurfaceConfig config);
+/** Builds the surface now instead of on first use. Lazy building writes to the surface, so this
+ * must be called before the model is shared between threads. `ra_vehicle_init` calls it. */
+void tiremodel_build_surface(const TireModel* m);
+/** Frees the surface and goes back to evaluating the formula */
+void tiremodel_disable_surface(TireModel* m);
+
+/** `tiremodel_force` for four wheels at once, one wheel per lane, with the x and y of the forces
+ * in separate arrays. Bit-identical to calling `tiremodel_force` for each wheel. The exact mode
+ * still calls atanf and sinf once per lane, and models with a surface are looked up one lane at a
+ * time. */
+void tiremodel_force_4(const TireModel* m, const float normal_force[4], const float slip_ratio[4],
+    const float slip_angle[4], const float friction_coefficent[4], float force_x[4],
+    float force_y[4]);
 
 #endif /* RA_TIREMODEL_H */
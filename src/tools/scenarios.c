@@ -0,0 +1,129 @@
+#include "../executor.h"
+#include "../racbil.h"
+#include "../tests/test.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Drives the car of main.c through every scenario file given, in one process, and writes one CSV
+ * row per scenario to stdout: the time the scenario ended, the distance driven, the top speed in
+ * km/h, the speed at the end in km/h and the state hash of the vehicle. The scenario format is
+ * described in scenario.h. A scenario is cut off after --max-time seconds (600).
+ */
+
+typedef struct {
+    const char* path;
+    raScenario scenario;
+    raScenarioCursor cursor;
+    float distance;
+    float top_speed;
+    float end_speed;
+    uint64_t hash;
+} Run;
+
+/** Steps all runs at once on `e`, dropping runs as their scenarios end */
+static void run_all(raExecutor* e, Run* runs, size_t num_runs, float dt, float max_time)
+{
+    raVehicle* vehicles
+        = ra_alloc_aligned(&ra_heap_allocator, num_runs * sizeof(raVehicle), RA_CACHE_LINE);
+    raInputs* inputs = ra_alloc(&ra_heap_allocator, num_runs * sizeof(raInputs));
+    size_t* active = ra_alloc(&ra_heap_allocator, num_runs * sizeof(size_t));
+
+    TireModel model = test_tire_model();
+    raVehicleParams params = test_vehicle_params(&model);
+    for (size_t i = 0; i < num_runs; i++) {
+        if (ra_vehicle_init(&vehicles[i], &params, test_vehicle_parts(&params)) != 0) {
+            exit(EXIT_FAILURE);
+        }
+        active[i] = i;
+    }
+
+    size_t num_active = num_runs;
+    while (num_active > 0) {
+        // Ended runs are replaced by the last active one
+        for (size_t i = 0; i < num_active;) {
+            Run* r = &runs[active[i]];
+            if (r->cursor.time < max_time
+                && ra_scenario_next(&r->scenario, &r->cursor, &vehicles[i], dt, &inputs[i])) {
+                i++;
+                continue;
+            }
+
+            r->end_speed = vehicles[i].velocity.x;
+            r->hash = ra_vehicle_hash(&vehicles[i], RA_VEHICLE_HASH_INIT);
+            ra_vehicle_free(&vehicles[i]);
+            num_active--;
+            vehicles[i] = vehicles[num_active];
+            active[i] = active[num_active];
+        }
+
+        ra_executor_step(e, vehicles, inputs, num_active, dt);
+        for (size_t i = 0; i < num_active; i++) {
+            Run* r = &runs[active[i]];
+            r->distance += vehicles[i].velocity.x * dt;
+            r->top_speed = fmaxf(r->top_speed, vehicles[i].velocity.x);
+        }
+    }
+
+    ra_free(&ra_heap_allocator, active);
+    ra_free(&ra_heap_allocator, inputs);
+    ra_free(&ra_heap_allocator, vehicles);
+}
+
+int main(int argc, char** argv)
+{
+    long num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+    float max_time = 600.0f;
+    float dt = 1.0f / 200.0f;
+
+    Run* runs = ra_alloc(&ra_heap_allocator, (size_t)argc * sizeof(Run));
+    size_t num_runs = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            num_threads = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--max-time") == 0 && i + 1 < argc) {
+            max_time = strtof(argv[++i], NULL);
+        } else {
+            Run* r = &runs[num_runs++];
+            *r = (Run) { .path = argv[i] };
+
+            size_t line = 0;
+            RaErrorScenario err = ra_scenario_load(&r->scenario, r->path, &line);
+            if (err == RaErrorScenarioSyntax) {
+                fprintf(stderr, "%s:%zu: Invalid statement\n", r->path, line);
+                exit(EXIT_FAILURE);
+            } else if (err != 0) {
+                fprintf(stderr, "Could not load %s\n", r->path);
+                exit(EXIT_FAILURE);
+            }
+            r->cursor = ra_scenario_cursor_new(&r->scenario);
+        }
+    }
+
+    if (num_runs == 0 || num_threads < 1) {
+        fprintf(stderr, "Usage: %s [--threads <n>] [--max-time <s>] <file.scenario>...\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    raExecutor e;
+    ra_executor_init(&e, (size_t)num_threads);
+    run_all(&e, runs, num_runs, dt, max_time);
+    ra_executor_free(&e);
+
+    puts("scenario,time,distance,top_speed,end_speed,hash");
+    for (size_t i = 0; i < num_runs; i++) {
+        const Run* r = &runs[i];
+        printf("%s,%.3f,%.2f,%.2f,%.2f,%016llx\n", r->path, r->cursor.time, r->distance,
+            r->top_speed * 3.6f, r->end_speed * 3.6f, (unsigned long long)r->hash);
+        ra_scenario_free(&runs[i].scenario);
+    }
+
+    ra_free(&ra_heap_allocator, runs);
+    return 0;
+}
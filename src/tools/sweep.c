@@ -0,0 +1,456 @@
+#include "../executor.h"
+#include "../racbil.h"
+#include "../tests/test.h"
+#include <cjson/cJSON.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Runs the car of main.c for every combination of a grid of parameters, and writes one CSV row of
+ * metrics per combination to stdout.
+ *
+ * The grid is a JSON object where every axis is optional and defaults to the car of main.c:
+ *   "gear_ratios": [[-3.6, 3.2, 2.31, ...], ...] sets of gear ratios, reverse first
+ *   "tire_bx", "tire_by", "tire_cx", "tire_cy", "tire_dx", "tire_dy", "tire_ex", "tire_ey",
+ *   "differential_ratio", "clutch_torque": [...] lists of values. The clutch torque is the max
+ *   static torque, the kinetic torque is 0.8 of it.
+ *
+ * The driver launches like main.c with full throttle, shifts up at "shift_rpm" (4500) and brakes
+ * fully from "brake_speed" in km/h, if given. A run ends after "max_time" seconds (60), or earlier
+ * on "stop":
+ *   "target_speed" on reaching "target_speed" in km/h (100), the default without "brake_speed"
+ *   "standstill" when stopped after braking, the default with "brake_speed"
+ *   "max_time" never earlier
+ * "dt" is the time step (0.005).
+ *
+ * The columns are the parameters of the run, with the index of the gear ratio set, followed by
+ * time_to_speed and distance_to_speed to the target speed, stopping_time and stopping_distance from
+ * the brake speed, top_speed in km/h and the time the run ended. Metrics a run did not get to are
+ * nan.
+ */
+
+/** Runs stepped at once, so large grids are not all in memory */
+#define MAX_ACTIVE_RUNS 4096
+/** Below this speed in m/s a braking car has stopped */
+#define STANDSTILL_SPEED 0.05f
+
+enum {
+    AxisTireBx,
+    AxisTireBy,
+    AxisTireCx,
+    AxisTireCy,
+    AxisTireDx,
+    AxisTireDy,
+    AxisTireEx,
+    AxisTireEy,
+    AxisDifferentialRatio,
+    AxisClutchTorque,
+    NUM_AXES,
+};
+
+static const char* axis_names[NUM_AXES] = {
+    "tire_bx",
+    "tire_by",
+    "tire_cx",
+    "tire_cy",
+    "tire_dx",
+    "tire_dy",
+    "tire_ex",
+    "tire_ey",
+    "differential_ratio",
+    "clutch_torque",
+};
+
+typedef enum { StopTargetSpeed, StopStandstill, StopMaxTime } Stop;
+
+typedef struct {
+    /** Reverse first, like `gearbox_new` */
+    VecFloat* gear_ratios;
+    size_t num_gear_ratios;
+    VecFloat axes[NUM_AXES];
+
+    /** m/s, infinity without braking */
+    float brake_speed;
+    /** m/s */
+    float target_speed;
+    AngularVelocity shift_velocity;
+    Stop stop;
+    float max_time;
+    float dt;
+} Grid;
+
+typedef struct {
+    size_t gear_ratios;
+    float values[NUM_AXES];
+    /** Pointed to by the parameters of the vehicle */
+    TireModel model;
+
+    float time;
+    float distance;
+    float clutch;
+    bool braking;
+    float brake_time;
+    float brake_distance;
+
+    float time_to_speed;
+    float distance_to_speed;
+    float stopping_time;
+    float stopping_distance;
+    float top_speed;
+} Run;
+
+/** Reads a non-empty array of numbers, or `fallback` if `arr` is missing */
+static bool vec_from_json(const cJSON* arr, float fallback, VecFloat* v)
+{
+    if (arr == NULL) {
+        *v = vec_with_capacity(1);
+        vec_push_float(v, fallback);
+        return true;
+    }
+
+    if (!cJSON_IsArray(arr) || cJSON_GetArraySize(arr) == 0) {
+        return false;
+    }
+
+    *v = vec_with_capacity(cJSON_GetArraySize(arr));
+    const cJSON* item;
+    cJSON_ArrayForEach(item, arr)
+    {
+        if (!cJSON_IsNumber(item)) {
+            vec_free(v);
+            return false;
+        }
+        vec_push_float(v, (float)cJSON_GetNumberValue(item));
+    }
+    return true;
+}
+
+static bool number_from_json(const cJSON* json, const char* name, float fallback, float* value)
+{
+    const cJSON* item = cJSON_GetObjectItemCaseSensitive(json, name);
+    *value = cJSON_IsNumber(item) ? (float)cJSON_GetNumberValue(item) : fallback;
+    return item == NULL || cJSON_IsNumber(item);
+}
+
+static void grid_free(Grid* g)
+{
+    for (size_t i = 0; i < g->num_gear_ratios; i++) {
+        vec_free(&g->gear_ratios[i]);
+    }
+    ra_free(&ra_heap_allocator, g->gear_ratios);
+    for (int a = 0; a < NUM_AXES; a++) {
+        vec_free(&g->axes[a]);
+    }
+}
+
+static bool grid_from_json(const char* text, Grid* g)
+{
+    *g = (Grid) { 0 };
+    cJSON* json = cJSON_Parse(text);
+    if (!cJSON_IsObject(json)) {
+        cJSON_Delete(json);
+        return false;
+    }
+
+    TireModel model = test_tire_model();
+    float defaults[NUM_AXES] = { model.bx, model.by, model.cx, model.cy, model.dx, model.dy,
+        model.ex, model.ey, 2.4f, 300.0f };
+    bool ok = true;
+    for (int a = 0; a < NUM_AXES; a++) {
+        const cJSON* arr = cJSON_GetObjectItemCaseSensitive(json, axis_names[a]);
+        ok = ok && vec_from_json(arr, defaults[a], &g->axes[a]);
+    }
+
+    const cJSON* sets = cJSON_GetObjectItemCaseSensitive(json, "gear_ratios");
+    if (sets == NULL) {
+        Gearbox* gb = test_gearbox();
+        g->num_gear_ratios = 1;
+        g->gear_ratios = ra_alloc(&ra_heap_allocator, sizeof(VecFloat));
+        g->gear_ratios[0] = vec_clone_in(&ra_heap_allocator, &gb->ratios);
+        gearbox_free(gb);
+    } else if (cJSON_IsArray(sets) && cJSON_GetArraySize(sets) > 0) {
+        g->gear_ratios
+            = ra_alloc(&ra_heap_allocator, cJSON_GetArraySize(sets) * sizeof(VecFloat));
+        const cJSON* set;
+        cJSON_ArrayForEach(set, sets)
+        {
+            // A reverse and at least one forward gear
+            if (!ok || !cJSON_IsArray(set) || cJSON_GetArraySize(set) < 2
+                || !vec_from_json(set, 0.0f, &g->gear_ratios[g->num_gear_ratios])) {
+                ok = false;
+                break;
+            }
+            g->num_gear_ratios++;
+        }
+    } else {
+        ok = false;
+    }
+
+    float brake_speed = INFINITY;
+    float target_speed = 100.0f;
+    float shift_rpm = 4500.0f;
+    ok = ok && number_from_json(json, "brake_speed", INFINITY, &brake_speed)
+        && number_from_json(json, "target_speed", 100.0f, &target_speed)
+        && number_from_json(json, "shift_rpm", 4500.0f, &shift_rpm)
+        && number_from_json(json, "max_time", 60.0f, &g->max_time)
+        && number_from_json(json, "dt", 1.0f / 200.0f, &g->dt) && g->dt > 0.0f;
+    g->brake_speed = brake_speed / 3.6f;
+    g->target_speed = target_speed / 3.6f;
+    g->shift_velocity = rpm_to_rads(shift_rpm);
+
+    const cJSON* stop = cJSON_GetObjectItemCaseSensitive(json, "stop");
+    g->stop = isinf(brake_speed) ? StopTargetSpeed : StopStandstill;
+    if (cJSON_IsString(stop)) {
+        const char* s = cJSON_GetStringValue(stop);
+        if (strcmp(s, "target_speed") == 0) {
+            g->stop = StopTargetSpeed;
+        } else if (strcmp(s, "standstill") == 0) {
+            g->stop = StopStandstill;
+        } else if (strcmp(s, "max_time") == 0) {
+            g->stop = StopMaxTime;
+        } else {
+            ok = false;
+        }
+    } else if (stop != NULL) {
+        ok = false;
+    }
+
+    cJSON_Delete(json);
+    if (!ok) {
+        grid_free(g);
+    }
+    return ok;
+}
+
+static size_t grid_num_runs(const Grid* g)
+{
+    size_t n = g->num_gear_ratios;
+    for (int a = 0; a < NUM_AXES; a++) {
+        n *= g->axes[a].len;
+    }
+    return n;
+}
+
+/** The combination with index `index`, with the gear ratios changing fastest */
+static Run run_new(const Grid* g, size_t index)
+{
+    Run r = {
+        .gear_ratios = index % g->num_gear_ratios,
+        .clutch = 1.0f,
+        .time_to_speed = NAN,
+        .distance_to_speed = NAN,
+        .stopping_time = NAN,
+        .stopping_distance = NAN,
+    };
+    index /= g->num_gear_ratios;
+    for (int a = 0; a < NUM_AXES; a++) {
+        r.values[a] = g->axes[a].elements[index % g->axes[a].len];
+        index /= g->axes[a].len;
+    }
+
+    r.model = test_tire_model();
+    r.model.bx = r.values[AxisTireBx];
+    r.model.by = r.values[AxisTireBy];
+    r.model.cx = r.values[AxisTireCx];
+    r.model.cy = r.values[AxisTireCy];
+    r.model.dx = r.values[AxisTireDx];
+    r.model.dy = r.values[AxisTireDy];
+    r.model.ex = r.values[AxisTireEx];
+    r.model.ey = r.values[AxisTireEy];
+    return r;
+}
+
+/** The car of main.c with the parameters of the run. `r` must not move while `v` is used. */
+static void run_vehicle_init(const Run* r, const Grid* g, raVehicle* v)
+{
+    raVehicleParams params = test_vehicle_params(&r->model);
+    raVehicleParts parts = test_vehicle_parts(&params);
+
+    // Gears past the ones of the test gearbox get the inertia of its highest gear
+    const VecFloat* ratios = &g->gear_ratios[r->gear_ratios];
+    VecFloat inertias = vec_with_capacity(ratios->len);
+    for (size_t i = 0; i < ratios->len; i++) {
+        size_t k = i < parts.gearbox->inertias.len ? i : parts.gearbox->inertias.len - 1;
+        vec_push_float(&inertias, parts.gearbox->inertias.elements[k]);
+    }
+    gearbox_free(parts.gearbox);
+    parts.gearbox = gearbox_new(vec_clone_in(&ra_heap_allocator, ratios), inertias);
+    parts.gearbox->curr_gear = 1;
+
+    float diff_inertia = parts.differential->inertia;
+    ra_free(&ra_heap_allocator, parts.differential);
+    parts.differential
+        = differential_new(r->values[AxisDifferentialRatio], diff_inertia, DiffTypeLocked);
+
+    float torque = r->values[AxisClutchTorque];
+    ra_free(&ra_heap_allocator, parts.clutch);
+    parts.clutch = clutch_with_torque(&parts.clutch_normal_force, torque, 0.8f * torque);
+
+    if (ra_vehicle_init(v, &params, parts) != 0) {
+        exit(EXIT_FAILURE);
+    }
+}
+
+/** The driver of main.c, shifting up and braking where the grid says */
+static raInputs run_drive(Run* r, const Grid* g, raVehicle* v)
+{
+    if (!r->braking && v->velocity.x >= g->brake_speed) {
+        r->braking = true;
+        r->brake_time = r->time;
+        r->brake_distance = r->distance;
+    }
+
+    if (r->braking) {
+        if (v->engine->angular_velocity <= v->params.idle_velocity) {
+            r->clutch = 1.0f;
+        }
+        return (raInputs) { .throttle = 0.0f, .brake = 1.0f, .clutch = r->clutch };
+    }
+
+    r->clutch = fminf(1.0, fmaxf(0.0, 1.0 - r->time * r->time * 0.09));
+    // The engine revs freely while the clutch slips at launch
+    if (r->clutch == 0.0f && v->engine->angular_velocity >= g->shift_velocity) {
+        gearbox_upshift(v->gearbox);
+    }
+    return (raInputs) { .throttle = 1.0f, .brake = 0.0f, .clutch = r->clutch };
+}
+
+/** Records the metrics of the step, and returns whether the run is over */
+static bool run_measure(Run* r, const Grid* g, const raVehicle* v)
+{
+    float speed = v->velocity.x;
+    r->time += g->dt;
+    r->distance += speed * g->dt;
+    r->top_speed = fmaxf(r->top_speed, speed);
+
+    if (isnan(r->time_to_speed) && speed >= g->target_speed) {
+        r->time_to_speed = r->time;
+        r->distance_to_speed = r->distance;
+    }
+
+    if (r->braking && isnan(r->stopping_time) && speed <= STANDSTILL_SPEED) {
+        r->stopping_time = r->time - r->brake_time;
+        r->stopping_distance = r->distance - r->brake_distance;
+    }
+
+    bool stopped = (g->stop == StopTargetSpeed && !isnan(r->time_to_speed))
+        || (g->stop == StopStandstill && !isnan(r->stopping_time));
+    return stopped || r->time >= g->max_time;
+}
+
+static void print_header(void)
+{
+    printf("gear_ratios");
+    for (int a = 0; a < NUM_AXES; a++) {
+        printf(",%s", axis_names[a]);
+    }
+    puts(",time_to_speed,distance_to_speed,stopping_time,stopping_distance,top_speed,time");
+}
+
+static void print_run(const Run* r)
+{
+    printf("%zu", r->gear_ratios);
+    for (int a = 0; a < NUM_AXES; a++) {
+        printf(",%g", r->values[a]);
+    }
+    printf(",%.3f,%.2f,%.3f,%.2f,%.2f,%.3f\n", r->time_to_speed, r->distance_to_speed,
+        r->stopping_time, r->stopping_distance, r->top_speed * 3.6f, r->time);
+}
+
+/** Steps up to `MAX_ACTIVE_RUNS` runs at once on `e`, starting new runs as others end */
+static void sweep(raExecutor* e, const Grid* g, Run* runs, size_t num_runs)
+{
+    raVehicle* vehicles
+        = ra_alloc_aligned(&ra_heap_allocator, MAX_ACTIVE_RUNS * sizeof(raVehicle), RA_CACHE_LINE);
+    raInputs* inputs = ra_alloc(&ra_heap_allocator, MAX_ACTIVE_RUNS * sizeof(raInputs));
+    size_t* active = ra_alloc(&ra_heap_allocator, MAX_ACTIVE_RUNS * sizeof(size_t));
+    size_t num_active = 0;
+    size_t next_run = 0;
+
+    while (num_active > 0 || next_run < num_runs) {
+        while (num_active < MAX_ACTIVE_RUNS && next_run < num_runs) {
+            runs[next_run] = run_new(g, next_run);
+            run_vehicle_init(&runs[next_run], g, &vehicles[num_active]);
+            active[num_active++] = next_run++;
+        }
+
+        for (size_t i = 0; i < num_active; i++) {
+            inputs[i] = run_drive(&runs[active[i]], g, &vehicles[i]);
+        }
+        ra_executor_step(e, vehicles, inputs, num_active, g->dt);
+
+        // Ended runs are replaced by the last active one
+        for (size_t i = 0; i < num_active;) {
+            if (run_measure(&runs[active[i]], g, &vehicles[i])) {
+                ra_vehicle_free(&vehicles[i]);
+                num_active--;
+                vehicles[i] = vehicles[num_active];
+                active[i] = active[num_active];
+            } else {
+                i++;
+            }
+        }
+    }
+
+    ra_free(&ra_heap_allocator, active);
+    ra_free(&ra_heap_allocator, inputs);
+    ra_free(&ra_heap_allocator, vehicles);
+}
+
+int main(int argc, char** argv)
+{
+    long num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+    const char* path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            num_threads = strtol(argv[++i], NULL, 10);
+        } else if (path == NULL) {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+
+    if (path == NULL || num_threads < 1) {
+        fprintf(stderr, "Usage: %s <grid.json> [--threads <n>]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    char* text = ra_read_file(&ra_heap_allocator, path);
+    if (text == NULL) {
+        fprintf(stderr, "Could not read %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    Grid grid;
+    bool ok = grid_from_json(text, &grid);
+    ra_free(&ra_heap_allocator, text);
+    if (!ok) {
+        fprintf(stderr, "Invalid grid in %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    size_t num_runs = grid_num_runs(&grid);
+    Run* runs = ra_alloc(&ra_heap_allocator, num_runs * sizeof(Run));
+    raExecutor e;
+    ra_executor_init(&e, (size_t)num_threads);
+    sweep(&e, &grid, runs, num_runs);
+    ra_executor_free(&e);
+
+    // In the order of the grid, however the runs ended
+    print_header();
+    for (size_t i = 0; i < num_runs; i++) {
+        print_run(&runs[i]);
+    }
+
+    ra_free(&ra_heap_allocator, runs);
+    grid_free(&grid);
+    return 0;
+}
@@ -0,0 +1,172 @@
+#include "../common.h"
+#include "../tablefile.h"
+#include <cjson/cJSON.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Converts torque maps (or any other table) to the binary table format.
+ *
+ * JSON: { "x": [...], "y": [...], "z": [[...], ...] } where z has one row of y values per x.
+ * CSV: the first row is a label followed by the y breakpoints, every following row is an x
+ * breakpoint followed by its z values.
+ */
+
+static bool fill_axis(const cJSON* arr, float* axis, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        const cJSON* v = cJSON_GetArrayItem(arr, (int)i);
+        if (!cJSON_IsNumber(v)) {
+            return false;
+        }
+        axis[i] = (float)cJSON_GetNumberValue(v);
+    }
+    return true;
+}
+
+static bool table_from_json(const char* text, Table* table)
+{
+    cJSON* json = cJSON_Parse(text);
+    const cJSON* x = cJSON_GetObjectItemCaseSensitive(json, "x");
+    const cJSON* y = cJSON_GetObjectItemCaseSensitive(json, "y");
+    const cJSON* z = cJSON_GetObjectItemCaseSensitive(json, "z");
+
+    bool ok = cJSON_IsArray(x) && cJSON_IsArray(y) && cJSON_IsArray(z)
+        && cJSON_GetArraySize(x) >= 2 && cJSON_GetArraySize(y) >= 2
+        && cJSON_GetArraySize(z) == cJSON_GetArraySize(x);
+
+    if (ok) {
+        size_t nx = (size_t)cJSON_GetArraySize(x);
+        size_t ny = (size_t)cJSON_GetArraySize(y);
+        *table = table_with_capacity(nx, ny);
+        ok = fill_axis(x, table->x, nx) && fill_axis(y, table->y, ny);
+
+        for (size_t i = 0; ok && i < nx; i++) {
+            const cJSON* row = cJSON_GetArrayItem(z, (int)i);
+            ok = cJSON_IsArray(row) && (size_t)cJSON_GetArraySize(row) == ny
+                && fill_axis(row, table->z + i * ny, ny);
+        }
+
+        if (!ok) {
+            table_free(table);
+        }
+    }
+
+    cJSON_Delete(json);
+    return ok;
+}
+
+/** Parses up to `max` comma separated numbers of one line, skipping the first `skip` fields */
+static size_t parse_csv_line(const char* line, size_t skip, float* out, size_t max)
+{
+    size_t n = 0;
+    size_t field = 0;
+    const char* p = line;
+    while (*p != '\0' && *p != '\n') {
+        if (field >= skip) {
+            char* end;
+            float v = strtof(p, &end);
+            if (end == p) {
+                return 0;
+            }
+            if (out != NULL && n < max) {
+                out[n] = v;
+            }
+            n++;
+            p = end;
+        }
+
+        while (*p != '\0' && *p != ',' && *p != '\n') {
+            p++;
+        }
+
+        if (*p == ',') {
+            p++;
+        }
+        field++;
+    }
+
+    return n;
+}
+
+static const char* next_line(const char* p)
+{
+    while (*p != '\0' && *p != '\n') {
+        p++;
+    }
+    return *p == '\n' ? p + 1 : p;
+}
+
+static bool table_from_csv(const char* text, Table* table)
+{
+    size_t ny = parse_csv_line(text, 1, NULL, 0);
+    size_t nx = 0;
+    for (const char* p = next_line(text); *p != '\0'; p = next_line(p)) {
+        if (*p != '\n' && *p != '\r') {
+            nx++;
+        }
+    }
+
+    if (nx < 2 || ny < 2) {
+        return false;
+    }
+
+    *table = table_with_capacity(nx, ny);
+    parse_csv_line(text, 1, table->y, ny);
+
+    size_t i = 0;
+    for (const char* p = next_line(text); *p != '\0' && i < nx; p = next_line(p)) {
+        if (*p == '\n' || *p == '\r') {
+            continue;
+        }
+
+        float row[1];
+        if (parse_csv_line(p, 0, row, 1) != ny + 1
+            || parse_csv_line(p, 1, table->z + i * ny, ny) != ny) {
+            table_free(table);
+            return false;
+        }
+        table->x[i] = row[0];
+        i++;
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <input.json|input.csv> <output.ratb>\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    char* text = ra_read_file(&ra_heap_allocator, argv[1]);
+    if (text == NULL) {
+        fprintf(stderr, "Could not read %s\n", argv[1]);
+        exit(EXIT_FAILURE);
+    }
+
+    size_t len = strlen(argv[1]);
+    bool is_csv = len >= 4 && strcmp(argv[1] + len - 4, ".csv") == 0;
+
+    Table table;
+    bool ok = is_csv ? table_from_csv(text, &table) : table_from_json(text, &table);
+    ra_free(&ra_heap_allocator, text);
+
+    if (!ok) {
+        fprintf(stderr, "Invalid table in %s\n", argv[1]);
+        exit(EXIT_FAILURE);
+    }
+
+    // Evenly spaced axes are flagged, so lookups in the mapped file take the uniform fast path
+    Table detected = table_view(table.x_capacity, table.x, table.y_capacity, table.y, table.z);
+    if (table_file_write(&detected, argv[2]) != 0) {
+        fprintf(stderr, "Could not write %s\n", argv[2]);
+        table_free(&table);
+        exit(EXIT_FAILURE);
+    }
+
+    table_free(&table);
+    return 0;
+}
@@ -0,0 +1,254 @@
+#include "vehicle.h"
+#include <assert.h>
+#include <string.h>
+
+RaErrorTaggedComponent ra_vehicle_init(
+    raVehicle* v, const raVehicleParams* params, raVehicleParts parts)
+{
+    for (int i = 0; i < RA_VEHICLE_NUM_WHEELS; i++) {
+        for (int j = 0; j < i; j++) {
+            if (parts.wheels[i] == parts.wheels[j]) {
+                return RaErrorTaggedSame;
+            }
+        }
+    }
+
+    raTaggedComponent* c_engine = ra_tag_engine(parts.engine);
+    raTaggedComponent* c_clutch = ra_tag_clutch(parts.clutch);
+    raTaggedComponent* c_gearbox = ra_tag_gearbox(parts.gearbox);
+    raTaggedComponent* c_diff = ra_tag_differential(parts.differential);
+
+    // The components are new and distinct, so linking can not fail
+    bool linked = ra_tagged_add_next(c_engine, c_clutch) == 0
+        && ra_tagged_add_next(c_clutch, c_gearbox) == 0
+        && ra_tagged_add_next(c_gearbox, c_diff) == 0
+        && ra_tagged_add_next_left(c_diff, ra_tag_wheel(parts.wheels[raVehicleWheelRl])) == 0
+        && ra_tagged_add_next_right(c_diff, ra_tag_wheel(parts.wheels[raVehicleWheelRr])) == 0;
+    assert(linked);
+    SUPPRESS_UNUSED(linked);
+
+    *v = (raVehicle) {
+        .params = *params,
+        .engine = parts.engine,
+        .rev_limiter = parts.rev_limiter,
+        .clutch = ra_tagged_component_inner(c_clutch),
+        .clutch_normal_force = parts.clutch_normal_force,
+        .gearbox = parts.gearbox,
+        .powertrain = RA_POWERTRAIN_SYSTEM(ra_tag_wheel(parts.wheels[raVehicleWheelFl]),
+            ra_tag_wheel(parts.wheels[raVehicleWheelFr]), c_engine),
+        .velocity = vector2f_default(),
+        .position = vector2f_default(),
+        .yaw_velocity = 0.0f,
+        .rotation = 0.0f,
+        .engine_torque = 0.0f,
+        .force = vector2f_default(),
+    };
+
+    for (int i = 0; i < RA_VEHICLE_NUM_WHEELS; i++) {
+        v->wheels[i] = parts.wheels[i];
+        v->wheel_forces[i] = vector2f_default();
+    }
+
+    RaErrorTaggedComponent err = ra_powertrain_schedule_compile(
+        v->powertrain, v->powertrain.allocator, &v->schedule);
+    if (err != 0) {
+        ra_powertrain_system_free(v->powertrain);
+        return err;
+    }
+
+    // Steps only read the tire model, so a surface is not built lazily on another thread
+    tiremodel_build_surface(params->tire_model);
+
+    return 0;
+}
+
+RaErrorTaggedComponent ra_vehicle_clone(const raVehicle* v, raAllocator* a, raVehicle* clone)
+{
+    raPowertrainSystem powertrain;
+    RaErrorTaggedComponent err = ra_powertrain_system_clone(v->powertrain, a, true, &powertrain);
+    if (err != 0) {
+        return err;
+    }
+
+    *clone = *v;
+    clone->powertrain = powertrain;
+
+    raTaggedComponent** subsystems = clone->powertrain.subsystems;
+    raTaggedComponent* c_engine = subsystems[raVehicleSubsystemEngine];
+    raTaggedComponent* c_clutch = c_engine->tty.normal.next;
+    raTaggedComponent* c_gearbox = c_clutch->tty.normal.next;
+    raTaggedComponent* c_diff = c_gearbox->tty.normal.next;
+    clone->engine = ra_tagged_component_inner(c_engine);
+    clone->clutch = ra_tagged_component_inner(c_clutch);
+    clone->gearbox = ra_tagged_component_inner(c_gearbox);
+    clone->wheels[raVehicleWheelFl] = ra_tagged_component_inner(subsystems[raVehicleSubsystemFl]);
+    clone->wheels[raVehicleWheelFr] = ra_tagged_component_inner(subsystems[raVehicleSubsystemFr]);
+    clone->wheels[raVehicleWheelRl] = ra_tagged_component_inner(c_diff->tty.split.next_left);
+    clone->wheels[raVehicleWheelRr] = ra_tagged_component_inner(c_diff->tty.split.next_right);
+
+    err = ra_powertrain_schedule_compile(clone->powertrain, a, &clone->schedule);
+    if (err != 0) {
+        ra_powertrain_system_free(clone->powertrain);
+        return err;
+    }
+
+    return 0;
+}
+
+RaErrorTaggedComponent ra_vehicle_clone_aligned(
+    const raVehicle* v, size_t num_clones, raArena* arena, raVehicle* clones)
+{
+    // The block of an arena starts on a cache line, so every clone is laid out like the probe.
+    // Parameters such as the torque map are shared, which leaves little to copy.
+    raArena probe;
+    ra_arena_init(&probe, 1 << 16);
+    raVehicle clone;
+    RaErrorTaggedComponent err = ra_vehicle_clone(v, &probe.allocator, &clone);
+    ra_arena_align(&probe, RA_CACHE_LINE);
+    size_t per_clone = probe.used;
+    ra_arena_free(&probe);
+    if (err != 0) {
+        return err;
+    }
+
+    ra_arena_init(arena, num_clones * per_clone);
+    for (size_t i = 0; i < num_clones; i++) {
+        // Can not fail once the probe was cloned
+        ra_vehicle_clone(v, &arena->allocator, &clones[i]);
+        ra_arena_align(arena, RA_CACHE_LINE);
+    }
+
+    return 0;
+}
+
+void ra_vehicle_free(raVehicle* v)
+{
+    ra_powertrain_schedule_free(&v->schedule);
+    ra_powertrain_system_free(v->powertrain);
+}
+
+void ra_vehicle_step(raVehicle* v, const raInputs* in, float dt)
+{
+    const raVehicleParams* p = &v->params;
+    Wheel** wheels = v->wheels;
+
+    if (v->gearbox->curr_gear == 1) {
+        for (int i = 0; i < RA_VEHICLE_NUM_WHEELS; ++i) {
+            wheel_try_change_direction(wheels[i], WheelDirectionForward);
+        }
+    } else if (v->gearbox->curr_gear == -1) {
+        for (int i = 0; i < RA_VEHICLE_NUM_WHEELS; ++i) {
+            wheel_try_change_direction(wheels[i], WheelDirectionReverse);
+        }
+    }
+
+    set_ackerman_angle(in->steering * p->steering_ratio, p->body.wheelbase,
+        wheels[raVehicleWheelFl], wheels[raVehicleWheelFr]);
+
+    float throttle = rev_limiter_hard(&v->rev_limiter, v->engine, in->throttle);
+    float pre_engine_torque = engine_torque(v->engine, throttle);
+    v->engine_torque = idle_engine_torque(
+        p->idle_velocity, v->engine, pre_engine_torque, in->clutch == 1.0, dt);
+
+    v->clutch->curr_normal_force = v->clutch_normal_force * (1.0 - in->clutch);
+
+    float master_pressure = p->master_cylinder.max_pressure * in->brake;
+    for (int i = 0; i < RA_VEHICLE_NUM_WHEELS; i++) {
+        float vel = wheels[i]->hub_velocity.x;
+        Vector2f slip = wheel_slip(wheels[i]);
+        float brake_pressure = abs_pressure(&p->abs[i], master_pressure, vel, slip.x);
+        wheels[i]->external_torque = brake_torque(
+            &p->brake_disc, &p->calipers[i], brake_pressure, wheels[i]->angular_velocity, vel);
+    }
+
+    raVelocities velocities
+        = (raVelocities) { .velocity_cog = v->velocity, .yaw_velocity_cog = v->yaw_velocity };
+    ra_powertrain_schedule_send_torque(&v->schedule, raVehicleSubsystemFr, 0.0, velocities, dt);
+    ra_powertrain_schedule_send_torque(&v->schedule, raVehicleSubsystemFl, 0.0, velocities, dt);
+    ra_powertrain_schedule_send_torque(
+        &v->schedule, raVehicleSubsystemEngine, v->engine_torque, velocities, dt);
+
+    float fz = p->mass * p->gravity * 0.5;
+    float fzf_lift = body_lift_front(&p->body, p->air_density, v->velocity.x);
+    float fzr_lift = body_lift_rear(&p->body, p->air_density, v->velocity.x);
+
+    float fz_front = (fz + fzf_lift) * 0.5;
+    float fz_rear = (fz + fzr_lift) * 0.5;
+    float fzs[RA_VEHICLE_NUM_WHEELS] = { fz_front, fz_front, fz_rear, fz_rear };
+
+    Vector2f sum_force = body_air_resistance(&p->body, p->air_density, v->velocity.x);
+    wheel_force_4(wheels, p->tire_model, fzs, p->friction, v->wheel_forces);
+
+    for (int i = 0; i < RA_VEHICLE_NUM_WHEELS; i++) {
+        sum_force = VECTOR2F_PLUS(sum_force, v->wheel_forces[i]);
+    }
+    v->force = sum_force;
+
+    v->velocity.x += integrate(sum_force.x / p->mass, dt);
+    v->velocity.y += integrate(sum_force.y / p->mass, dt);
+
+    if (signum(wheels[raVehicleWheelFl]->hub_velocity.x) != signum(v->velocity.x)) {
+        v->velocity.x = 0.0;
+    }
+
+    Vector2f vel_world = vector2f_rotate(v->velocity, v->rotation);
+    v->position.x += vel_world.x * dt;
+    v->position.y += vel_world.y * dt;
+
+    ra_powertrain_schedule_update_angular_velocity(&v->schedule);
+
+    float zz_torque = yaw_torque(wheels, v->wheel_forces, RA_VEHICLE_NUM_WHEELS);
+    v->yaw_velocity += zz_torque / p->i_zz * dt;
+    v->rotation += v->yaw_velocity * dt;
+}
+
+static uint64_t hash_bits(uint64_t hash, uint32_t bits)
+{
+    for (int i = 0; i < 4; i++) {
+        hash ^= (bits >> (8 * i)) & 0xff;
+        hash *= 0x100000001b3u;
+    }
+    return hash;
+}
+
+static uint64_t hash_float(uint64_t hash, float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof bits);
+    return hash_bits(hash, bits);
+}
+
+static uint64_t hash_vector2f(uint64_t hash, Vector2f v)
+{
+    return hash_float(hash_float(hash, v.x), v.y);
+}
+
+uint64_t ra_vehicle_hash(const raVehicle* v, uint64_t hash)
+{
+    hash = hash_vector2f(hash, v->velocity);
+    hash = hash_vector2f(hash, v->position);
+    hash = hash_float(hash, v->yaw_velocity);
+    hash = hash_float(hash, v->rotation);
+    hash = hash_float(hash, v->engine_torque);
+    hash = hash_vector2f(hash, v->force);
+
+    hash = hash_float(hash, v->engine->angular_velocity);
+    hash = hash_bits(hash, v->rev_limiter.is_active);
+    hash = hash_float(hash, v->clutch->curr_normal_force);
+    hash = hash_bits(hash, v->clutch->c->is_locked);
+    hash = hash_bits(hash, (uint32_t)v->gearbox->curr_gear);
+    hash = hash_float(hash, v->gearbox->input_angular_velocity);
+
+    for (int i = 0; i < RA_VEHICLE_NUM_WHEELS; i++) {
+        const Wheel* w = v->wheels[i];
+        hash = hash_vector2f(hash, v->wheel_forces[i]);
+        hash = hash_vector2f(hash, w->hub_velocity);
+        hash = hash_float(hash, w->angular_velocity);
+        hash = hash_float(hash, w->angle);
+        hash = hash_float(hash, w->reaction_torque);
+        hash = hash_float(hash, w->external_torque);
+        hash = hash_float(hash, w->input_torque);
+    }
+
+    return hash;
+}
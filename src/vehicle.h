@@ -0,0 +1,122 @@
+#ifndef RA_VEHICLE_H
+#define RA_VEHICLE_H
+#include "assists.h"
+#include "body.h"
+#include "brake.h"
+#include "common.h"
+#include "powertrain.h"
+#include "powertrainabs.h"
+#include "tiremodel.h"
+#include "wheel.h"
+#include <stdint.h>
+
+#define RA_VEHICLE_NUM_WHEELS 4
+/** What `ra_vehicle_hash` starts from, the FNV-1a offset basis */
+#define RA_VEHICLE_HASH_INIT 0xcbf29ce484222325u
+
+/** Order of the per wheel arrays */
+enum { raVehicleWheelFl, raVehicleWheelFr, raVehicleWheelRl, raVehicleWheelRr };
+/** Subsystems of `raVehicle.powertrain`. The front wheels are subsystems of their own. */
+enum { raVehicleSubsystemFl, raVehicleSubsystemFr, raVehicleSubsystemEngine };
+
+/** What the driver does during one step */
+typedef struct {
+    /** 0.0 to 1.0 */
+    float throttle;
+    /** 0.0 to 1.0 */
+    float brake;
+    /** 0.0 is fully engaged and 1.0 fully pressed */
+    float clutch;
+    /** Angle of the steering wheel in radians */
+    float steering;
+} raInputs;
+
+/** Everything about a vehicle that does not change while stepping. Per wheel arrays are in the
+ * order front left, front right, rear left, rear right. */
+typedef struct {
+    Body body;
+    float mass;
+    /** Moment of inertia around the vertical axis */
+    float i_zz;
+    float gravity;
+    float air_density;
+    /** Wheel angle per steering wheel angle */
+    float steering_ratio;
+    /** The engine does not go below this while the clutch is fully pressed */
+    float idle_velocity;
+    MasterCylinder master_cylinder;
+    BrakeDisc brake_disc;
+    Caliper calipers[RA_VEHICLE_NUM_WHEELS];
+    Abs abs[RA_VEHICLE_NUM_WHEELS];
+    float friction[RA_VEHICLE_NUM_WHEELS];
+    /** Not owned, so it can be shared between vehicles. A surface must be enabled before
+     * `ra_vehicle_init`, which builds it. */
+    const TireModel* tire_model;
+} raVehicleParams;
+
+/** The parts `ra_vehicle_init` links into a powertrain */
+typedef struct {
+    Engine* engine;
+    RevLimiterHard rev_limiter;
+    Clutch* clutch;
+    /** From `clutch_with_torque` */
+    float clutch_normal_force;
+    Gearbox* gearbox;
+    Differential* differential;
+    /** Front left, front right, rear left, rear right */
+    Wheel* wheels[RA_VEHICLE_NUM_WHEELS];
+} raVehicleParts;
+
+/** A four wheeled, rear wheel drive vehicle. The engine drives the rear wheels through the clutch,
+ * gearbox and differential, and the front wheels are free. */
+typedef struct {
+    raVehicleParams params;
+    Engine* engine;
+    RevLimiterHard rev_limiter;
+    ClutchTagged* clutch;
+    float clutch_normal_force;
+    Gearbox* gearbox;
+    Wheel* wheels[RA_VEHICLE_NUM_WHEELS];
+    raPowertrainSystem powertrain;
+    raPowertrainSchedule schedule;
+
+    /** In iso8855 coordinates */
+    Vector2f velocity;
+    Vector2f position;
+    float yaw_velocity;
+    float rotation;
+
+    /** From the last step. `force` is the sum of the tire forces and air resistance. */
+    float engine_torque;
+    Vector2f force;
+    Vector2f wheel_forces[RA_VEHICLE_NUM_WHEELS];
+} raVehicle;
+
+/** Takes ownership of the parts, and compiles the powertrain into a schedule. The vehicle starts at
+ * rest at the origin. Returns `RaErrorTaggedSame` and takes nothing if a wheel is given twice. If
+ * the powertrain can not be compiled the parts are freed and the error of
+ * `ra_powertrain_schedule_compile` is returned. */
+RaErrorTaggedComponent ra_vehicle_init(
+    raVehicle* v, const raVehicleParams* params, raVehicleParts parts);
+/** Copies the vehicle, its schedule and its state into `a`, sharing its parameters, such as the
+ * torque map and the tire model. `v` must outlive the clone. Returns the error of
+ * `ra_powertrain_system_clone` or `ra_powertrain_schedule_compile`, with nothing left allocated, if
+ * it can not be copied. */
+RaErrorTaggedComponent ra_vehicle_clone(const raVehicle* v, raAllocator* a, raVehicle* clone);
+/** Clones `v` into each of the `num_clones` vehicles of `clones`, all in `arena`, which is made
+ * just big enough. Every clone starts on a cache line and is padded to the end of one, so clones
+ * stepped from different threads, like by `ra_executor_step`, never write to the same cache line.
+ * The clones go with `ra_arena_free`. Returns the error of `ra_vehicle_clone`, without making the
+ * arena, if `v` can not be copied. */
+RaErrorTaggedComponent ra_vehicle_clone_aligned(
+    const raVehicle* v, size_t num_clones, raArena* arena, raVehicle* clones);
+void ra_vehicle_free(raVehicle* v);
+/** Steering, engine, brakes, powertrain, aerodynamics, tire forces and integration of the body for
+ * one step. Allocates nothing and only touches `v`, so vehicles can be stepped from different
+ * threads. The tire model is only read, its surface is built by `ra_vehicle_init`. */
+void ra_vehicle_step(raVehicle* v, const raInputs* in, float dt);
+/** Folds the bits of everything a step changes into `hash` with FNV-1a, so runs can be compared bit
+ * for bit. Start from `RA_VEHICLE_HASH_INIT`, and pass the result on to hash several vehicles. */
+uint64_t ra_vehicle_hash(const raVehicle* v, uint64_t hash);
+
+#endif /* RA_VEHICLE_H */
@@ -1,13 +1,17 @@
 #include "wheel.h"
 #include "common.h"
+#include "simd.h"
 #include <stdlib.h>
 
 Wheel* wheel_new(float inertia, float radius, Vector2f position, float min_speed)
 {
-    Wheel* w = malloc(sizeof *w);
-    if (w == NULL) {
-        exit(EXIT_FAILURE);
-    }
+    return wheel_new_in(&ra_heap_allocator, inertia, radius, position, min_speed);
+}
+
+Wheel* wheel_new_in(
+    raAllocator* a, float inertia, float radius, Vector2f position, float min_speed)
+{
+    Wheel* w = ra_alloc_aligned(a, sizeof *w, RA_CACHE_LINE);
 
     w->inertia = inertia;
     w->effective_radius = radius;
@@ -22,26 +26,53 @@ Wheel* wheel_new(float inertia, float radius, Vector2f position, float min_speed
     return w;
 }
 
-void wheel_change_direction(Wheel* w, WheelDirection d)
+/** The state of `w` as the only wheel of a `WheelLanes` */
+static WheelLanes wheel_lanes_of(Wheel* w)
+{
+    return (WheelLanes) {
+        .hub_velocity_x = &w->hub_velocity.x,
+        .hub_velocity_y = &w->hub_velocity.y,
+        .angle = &w->angle,
+        .angular_velocity = &w->angular_velocity,
+        .input_torque = &w->input_torque,
+        .reaction_torque = &w->reaction_torque,
+        .external_torque = &w->external_torque,
+    };
+}
+
+static void change_direction(const WheelLanes* l, size_t k, const Wheel* w, WheelDirection d)
 {
     float min_angular = w->min_speed / w->effective_radius;
     if (d == WheelDirectionForward) {
-        w->angular_velocity = min_angular;
-        w->hub_velocity.x = w->min_speed;
+        l->angular_velocity[k] = min_angular;
+        l->hub_velocity_x[k] = w->min_speed;
     } else if (d == WheelDirectionReverse) {
-        w->angular_velocity = -min_angular;
-        w->hub_velocity.x = -w->min_speed;
+        l->angular_velocity[k] = -min_angular;
+        l->hub_velocity_x[k] = -w->min_speed;
     }
 }
 
-void wheel_try_change_direction(Wheel* w, WheelDirection d)
+void wheel_change_direction(Wheel* w, WheelDirection d)
+{
+    WheelLanes l = wheel_lanes_of(w);
+    change_direction(&l, 0, w, d);
+}
+
+void wheel_lanes_try_change_direction(
+    const WheelLanes* lanes, size_t k, const Wheel* w, WheelDirection d)
 {
-    if (fabsf(fabsf(w->hub_velocity.x) - w->min_speed) < EPSILON
-        && fabsf(w->angular_velocity) <= w->min_speed / w->effective_radius) {
-        wheel_change_direction(w, d);
+    if (fabsf(fabsf(lanes->hub_velocity_x[k]) - w->min_speed) < EPSILON
+        && fabsf(lanes->angular_velocity[k]) <= w->min_speed / w->effective_radius) {
+        change_direction(lanes, k, w, d);
     }
 }
 
+void wheel_try_change_direction(Wheel* w, WheelDirection d)
+{
+    WheelLanes l = wheel_lanes_of(w);
+    wheel_lanes_try_change_direction(&l, 0, w, d);
+}
+
 static Vector2f translate_velocity(
     Vector2f velocity_cog, float yaw_angular_velocity_cog, Vector2f position)
 {
@@ -51,53 +82,61 @@ static Vector2f translate_velocity(
     return (Vector2f) { .x = x, .y = y };
 }
 
-static void set_hub_speed(Wheel* wheel, Vector2f new_velocity)
+static void set_hub_speed(const WheelLanes* l, size_t k, const Wheel* w, Vector2f new_velocity)
 {
-    if (signum(new_velocity.x) != signum(wheel->hub_velocity.x)
-        || fabsf(new_velocity.x) < wheel->min_speed) {
+    float hub_velocity_x = l->hub_velocity_x[k];
+    if (signum(new_velocity.x) != signum(hub_velocity_x) || fabsf(new_velocity.x) < w->min_speed) {
         // This prevents driving in reverse, so the hub velocity must be flipped
         // manually when the car is set into reverse
-        wheel->hub_velocity.x = signum(wheel->hub_velocity.x) * wheel->min_speed;
+        l->hub_velocity_x[k] = signum(hub_velocity_x) * w->min_speed;
     } else {
-        wheel->hub_velocity.x = new_velocity.x;
+        l->hub_velocity_x[k] = new_velocity.x;
     }
 
-    wheel->hub_velocity.y = new_velocity.y;
+    l->hub_velocity_y[k] = new_velocity.y;
 }
 
-static void set_angular_velocity(Wheel* wheel, float new_velocity, Vector2f velocity_cog)
+static void set_angular_velocity(
+    const WheelLanes* l, size_t k, const Wheel* w, float new_velocity, Vector2f velocity_cog)
 {
     // Only apply artificial rotation when the vehicle is standing still
     if (velocity_cog.x < EPSILON) {
-        float new_thread_vel = new_velocity * wheel->effective_radius;
-        float hub_vel_dir = signum(wheel->hub_velocity.x);
-        if (fabsf(new_thread_vel) < wheel->min_speed || signum(new_thread_vel) != hub_vel_dir) {
-            wheel->angular_velocity = hub_vel_dir * wheel->min_speed / wheel->effective_radius;
+        float new_thread_vel = new_velocity * w->effective_radius;
+        float hub_vel_dir = signum(l->hub_velocity_x[k]);
+        if (fabsf(new_thread_vel) < w->min_speed || signum(new_thread_vel) != hub_vel_dir) {
+            l->angular_velocity[k] = hub_vel_dir * w->min_speed / w->effective_radius;
         } else {
-            wheel->angular_velocity = new_velocity;
+            l->angular_velocity[k] = new_velocity;
         }
-    } else if (signum(wheel->hub_velocity.x) != signum(new_velocity)) {
+    } else if (signum(l->hub_velocity_x[k]) != signum(new_velocity)) {
         // lock the wheel
-        wheel->angular_velocity = 0.0;
+        l->angular_velocity[k] = 0.0;
     } else {
-        wheel->angular_velocity = new_velocity;
+        l->angular_velocity[k] = new_velocity;
     }
 }
 
-void wheel_update(Wheel* wheel, Vector2f velocity_cog, float yaw_angular_velocity_cog,
-    float external_inertia, float torque, float dt)
+void wheel_lanes_update(const WheelLanes* lanes, size_t k, const Wheel* w, Vector2f velocity_cog,
+    float yaw_angular_velocity_cog, float external_inertia, float torque, float dt)
 {
-    Vector2f hub_velocity
-        = translate_velocity(velocity_cog, yaw_angular_velocity_cog, wheel->position);
-    set_hub_speed(wheel, hub_velocity);
+    Vector2f hub_velocity = translate_velocity(velocity_cog, yaw_angular_velocity_cog, w->position);
+    set_hub_speed(lanes, k, w, hub_velocity);
 
-    wheel->input_torque = torque;
+    lanes->input_torque[k] = torque;
 
-    float total_torque = torque + wheel->reaction_torque + wheel->external_torque;
-    float dv = total_torque / (external_inertia + wheel->inertia);
-    float new_velocity = wheel->angular_velocity + integrate(dv, dt);
+    float total_torque = torque + lanes->reaction_torque[k] + lanes->external_torque[k];
+    float dv = total_torque / (external_inertia + w->inertia);
+    float new_velocity = lanes->angular_velocity[k] + integrate(dv, dt);
+
+    set_angular_velocity(lanes, k, w, new_velocity, velocity_cog);
+}
 
-    set_angular_velocity(wheel, new_velocity, velocity_cog);
+void wheel_update(Wheel* wheel, Vector2f velocity_cog, float yaw_angular_velocity_cog,
+    float external_inertia, float torque, float dt)
+{
+    WheelLanes l = wheel_lanes_of(wheel);
+    wheel_lanes_update(
+        &l, 0, wheel, velocity_cog, yaw_angular_velocity_cog, external_inertia, torque, dt);
 }
 
 static float wheel_reaction_torque(const Wheel* wheel, Vector2f force)
@@ -137,10 +176,83 @@ static float wheel_ext_torque(raTaggedComponent* t)
     return w->reaction_torque + w->external_torque;
 }
 
-raTaggedComponent* ra_tag_wheel(Wheel* w)
+static bool wheel_flat_needs_children(raTaggedComponent* t, raQuery q)
+{
+    SUPPRESS_UNUSED(t);
+    SUPPRESS_UNUSED(q);
+    return false;
+}
+
+static float wheel_flat_query(
+    raPowertrainSchedule* s, size_t node, raQuery q, const float children[2])
+{
+    SUPPRESS_UNUSED(children);
+    Wheel* w = (Wheel*)s->nodes[node].c->ty;
+    switch (q) {
+    case raQueryExternalTorque:
+        return w->reaction_torque + w->external_torque;
+    case raQueryInertiaNext:
+        return w->inertia;
+    default:
+        return w->angular_velocity;
+    }
+}
+
+static float wheel_flat_inertia_prev(raPowertrainSchedule* s, size_t node, float up, int from)
+{
+    SUPPRESS_UNUSED(from);
+    return up + ((Wheel*)s->nodes[node].c->ty)->inertia;
+}
+
+static void wheel_flat_send_torque(
+    raPowertrainSchedule* s, size_t node, raVelocities v, float torque, float dt)
+{
+    const raScheduleNode* n = &s->nodes[node];
+    float inertia = ra_powertrain_schedule_inertia_prev(s, n->parent, n->slot);
+
+    wheel_update((Wheel*)n->c->ty, v.velocity_cog, v.yaw_velocity_cog, inertia, torque, dt);
+}
+
+static const raFlatOps wheel_flat_ops = {
+    .needs_children = wheel_flat_needs_children,
+    .query = wheel_flat_query,
+    .inertia_prev = wheel_flat_inertia_prev,
+    .send_torque = wheel_flat_send_torque,
+    .receive_torque = NULL,
+    .inertia_key = NULL,
+};
+
+Wheel* wheel_clone(raAllocator* a, const Wheel* w)
+{
+    Wheel* clone = ra_alloc_aligned(a, sizeof *clone, RA_CACHE_LINE);
+    *clone = *w;
+    return clone;
+}
+
+static void* wheel_clone_ty(raAllocator* a, const void* w, bool share)
 {
-    return ra_tagged_new(w, wheel_inertia, wheel_ang_vel, wheel_send_torque, NULL,
-        wheel_update_angular_velocity, wheel_ext_torque, free);
+    SUPPRESS_UNUSED(share);
+    return wheel_clone(a, (const Wheel*)w);
+}
+
+static const raComponentOps wheel_ops = {
+    .inertia_fn = wheel_inertia,
+    .angular_velocity_fn = wheel_ang_vel,
+    .send_torque_fn = wheel_send_torque,
+    .receive_torque = NULL,
+    .update_angular_velocity = wheel_update_angular_velocity,
+    .external_torque = wheel_ext_torque,
+    .free_fn = NULL,
+    .free_in_fn = ra_free,
+    .clone_fn = wheel_clone_ty,
+    .flat_ops = &wheel_flat_ops,
+};
+
+raTaggedComponent* ra_tag_wheel(Wheel* w) { return ra_tag_wheel_in(&ra_heap_allocator, w); }
+
+raTaggedComponent* ra_tag_wheel_in(raAllocator* a, Wheel* w)
+{
+    return ra_tagged_new_with_ops(a, w, raTyNormal, &wheel_ops);
 }
 
 Vector2f wheel_slip(const Wheel* wheel)
@@ -158,3 +270,86 @@ Vector2f wheel_force(Wheel* wheel, TireModel* model, float normal_force, float f
     wheel->reaction_torque = wheel_reaction_torque(wheel, force);
     return force;
 }
+
+#ifdef RA_SIMD_X86
+static void wheel_quad_force_sse(const WheelQuad* q, const TireModel* model,
+    const float normal_force[4], const float friction_coefficent[4], Vector2f force[4],
+    float reaction_torque[4])
+{
+    __m128 vx = _mm_loadu_ps(q->hub_velocity_x);
+    __m128 vy = _mm_loadu_ps(q->hub_velocity_y);
+    __m128 radius = _mm_loadu_ps(q->effective_radius);
+    __m128 wheel_angle = _mm_loadu_ps(q->angle);
+    __m128 sign = _mm_set1_ps(-0.0f);
+
+    __m128 thread_vel = _mm_mul_ps(_mm_loadu_ps(q->angular_velocity), radius);
+    __m128 slip_velocity = _mm_xor_ps(_mm_sub_ps(vx, thread_vel), sign);
+    __m128 denom = _mm_max_ps(_mm_andnot_ps(sign, vx), _mm_andnot_ps(sign, thread_vel));
+    __m128 angle = ra_simd_map(atanf, _mm_div_ps(vy, vx));
+
+    float slip_x[4], slip_y[4];
+    _mm_storeu_ps(slip_x, _mm_div_ps(slip_velocity, denom));
+    _mm_storeu_ps(slip_y, _mm_sub_ps(angle, wheel_angle));
+
+    float tire_x[4], tire_y[4];
+    tiremodel_force_4(model, normal_force, slip_x, slip_y, friction_coefficent, tire_x, tire_y);
+    __m128 fx = _mm_loadu_ps(tire_x);
+    __m128 fy = _mm_loadu_ps(tire_y);
+
+    _mm_storeu_ps(reaction_torque, _mm_mul_ps(_mm_xor_ps(fx, sign), radius));
+
+    __m128 rotation = _mm_xor_ps(wheel_angle, sign);
+    __m128 a_sin = ra_simd_map(sinf, rotation);
+    __m128 a_cos = ra_simd_map(cosf, rotation);
+    float x[4], y[4];
+    _mm_storeu_ps(x, _mm_sub_ps(_mm_mul_ps(fx, a_cos), _mm_mul_ps(fy, a_sin)));
+    _mm_storeu_ps(y, _mm_add_ps(_mm_mul_ps(fx, a_sin), _mm_mul_ps(fy, a_cos)));
+    for (int l = 0; l < 4; l++) {
+        force[l] = (Vector2f) { .x = x[l], .y = y[l] };
+    }
+}
+#endif
+
+void wheel_quad_force(const WheelQuad* q, const TireModel* model, const float normal_force[4],
+    const float friction_coefficent[4], Vector2f force[4], float reaction_torque[4])
+{
+#ifdef RA_SIMD_X86
+    wheel_quad_force_sse(q, model, normal_force, friction_coefficent, force, reaction_torque);
+#else
+    for (int l = 0; l < 4; l++) {
+        Vector2f v = (Vector2f) { .x = q->hub_velocity_x[l], .y = q->hub_velocity_y[l] };
+        float slip_x = slip_ratio(v, q->angular_velocity[l], q->effective_radius[l]);
+        float slip_y = slip_angle(v, q->angle[l]);
+        Vector2f f = tiremodel_force(
+            model, normal_force[l], slip_x, slip_y, friction_coefficent[l]);
+        reaction_torque[l] = -f.x * q->effective_radius[l];
+        force[l] = vector2f_rotate(f, -q->angle[l]);
+    }
+#endif
+}
+
+void wheel_force_4(Wheel* const wheels[4], const TireModel* model, const float normal_force[4],
+    const float friction_coefficent[4], Vector2f force[4])
+{
+    float hub_velocity_x[4], hub_velocity_y[4], angular_velocity[4], effective_radius[4], angle[4];
+    for (int l = 0; l < 4; l++) {
+        hub_velocity_x[l] = wheels[l]->hub_velocity.x;
+        hub_velocity_y[l] = wheels[l]->hub_velocity.y;
+        angular_velocity[l] = wheels[l]->angular_velocity;
+        effective_radius[l] = wheels[l]->effective_radius;
+        angle[l] = wheels[l]->angle;
+    }
+    WheelQuad q = {
+        .hub_velocity_x = hub_velocity_x,
+        .hub_velocity_y = hub_velocity_y,
+        .angular_velocity = angular_velocity,
+        .effective_radius = effective_radius,
+        .angle = angle,
+    };
+
+    float reaction_torque[4];
+    wheel_quad_force(&q, model, normal_force, friction_coefficent, force, reaction_torque);
+    for (int l = 0; l < 4; l++) {
+        wheels[l]->reaction_torque = reaction_torque[l];
+    }
+}
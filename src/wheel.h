@@ -6,6 +6,7 @@
 
 typedef enum { WheelDirectionForward, WheelDirectionReverse } WheelDirection;
 
+/** Wheels are allocated on a cache line boundary, so a wheel never straddles two lines */
 typedef struct {
     Vector2f hub_velocity;
     Vector2f position;
@@ -22,8 +23,35 @@ typedef struct {
     float external_torque;
 } Wheel;
 
+/** The state of many wheels in struct-of-arrays form, with one element per wheel in each array. The
+ * constants of the wheels, such as their position and inertia, are kept in a `Wheel` instead. */
+typedef struct {
+    float* hub_velocity_x;
+    float* hub_velocity_y;
+    float* angle;
+    float* angular_velocity;
+    float* input_torque;
+    float* reaction_torque;
+    float* external_torque;
+} WheelLanes;
+
+/** The state `wheel_quad_force` reads, for four wheels in struct-of-arrays form. Each field points
+ * at four floats with one wheel per lane. */
+typedef struct {
+    const float* hub_velocity_x;
+    const float* hub_velocity_y;
+    const float* angular_velocity;
+    const float* effective_radius;
+    const float* angle;
+} WheelQuad;
+
 Wheel* wheel_new(float inertia, float radius, Vector2f position, float min_speed);
+Wheel* wheel_new_in(
+    raAllocator* a, float inertia, float radius, Vector2f position, float min_speed);
+Wheel* wheel_clone(raAllocator* a, const Wheel* w);
 raTaggedComponent* ra_tag_wheel(Wheel* w);
+/** The wheel is freed with `a` along with the component */
+raTaggedComponent* ra_tag_wheel_in(raAllocator* a, Wheel* w);
 /** Changes the rotation direction of the wheel. It changes direction regardless whether
  * the current hub velocity is larger than min_speed. Upon direction change the hub_velocity
  * is always set to min_speed*/
@@ -34,10 +62,26 @@ void wheel_try_change_direction(Wheel* w, WheelDirection d);
 Vector2f wheel_slip(const Wheel* wheel);
 void wheel_update(Wheel* wheel, Vector2f velocity_cog, float yaw_angular_velocity_cog,
     float external_inertia, float torque, float dt);
+/** `wheel_try_change_direction` for wheel `k` of `lanes`, which has the constants of `w` */
+void wheel_lanes_try_change_direction(
+    const WheelLanes* lanes, size_t k, const Wheel* w, WheelDirection d);
+/** `wheel_update` for wheel `k` of `lanes`, which has the constants of `w` */
+void wheel_lanes_update(const WheelLanes* lanes, size_t k, const Wheel* w, Vector2f velocity_cog,
+    float yaw_angular_velocity_cog, float external_inertia, float torque, float dt);
 
 /**
  * wheel_update must be called before this function
  */
 Vector2f wheel_force(Wheel* wheel, TireModel* model, float normal_force, float friction_coefficent);
 
+/** Slip, tire force and the rotation of the force by -angle for four wheels at once. `force` is
+ * in the body frame and `reaction_torque` is what `wheel_force` stores in the wheel. Bit-identical
+ * to `wheel_force` followed by `vector2f_rotate`. */
+void wheel_quad_force(const WheelQuad* q, const TireModel* model, const float normal_force[4],
+    const float friction_coefficent[4], Vector2f force[4], float reaction_torque[4]);
+/** `wheel_force` and the rotation to the body frame for four wheels, through `wheel_quad_force`.
+ * wheel_update must be called before this function */
+void wheel_force_4(Wheel* const wheels[4], const TireModel* model, const float normal_force[4],
+    const float friction_coefficent[4], Vector2f force[4]);
+
 #endif /* RA_WHEEL_H */